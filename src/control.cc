@@ -177,6 +177,21 @@ bool performNetPerfMeterAddFlow(MessageReader* messageReader,
    if(flow->getTrafficSpec().RepeatOnOff == true) {
       addFlowMsg->Header.Flags |= NPMAFF_REPEATONOFF;
    }
+   if(flow->getTrafficSpec().UseGSO == true) {
+      addFlowMsg->Header.Flags |= NPMAFF_GSO;
+   }
+   if(flow->getTrafficSpec().UseZeroCopy == true) {
+      addFlowMsg->Header.Flags |= NPMAFF_ZEROCOPY;
+   }
+   if(flow->getTrafficSpec().Pacing == FlowTrafficSpec::PrecisePacing) {
+      addFlowMsg->Header.Flags |= NPMAFF_PRECISEPACING;
+   }
+   else if(flow->getTrafficSpec().Pacing == FlowTrafficSpec::SpinPacing) {
+      addFlowMsg->Header.Flags |= NPMAFF_SPINPACING;
+   }
+   else if(flow->getTrafficSpec().Pacing == FlowTrafficSpec::KernelPacing) {
+      addFlowMsg->Header.Flags |= NPMAFF_KERNELPACING;
+   }
 
    addFlowMsg->Header.Length = htobe16(addFlowMsgSize);
    addFlowMsg->MeasurementID = htobe64(flow->getMeasurementID());
@@ -393,6 +408,12 @@ bool performNetPerfMeterStart(MessageReader*         messageReader,
             fprintf(configFile, "FLOW%u_OUTBOUND_FRAME_SIZE_VALUE%u=%f\n",   flow->getFlowID(), i + 1, flow->getTrafficSpec().OutboundFrameSize[i]);
          }
          fprintf(configFile, "FLOW%u_OUTBOUND_FRAME_SIZE_RNG=%u\n",          flow->getFlowID(), flow->getTrafficSpec().OutboundFrameSizeRng);
+         if(flow->getTrafficSpec().OutboundFrameRateRng == RANDOM_TRACE) {
+            fprintf(configFile, "FLOW%u_OUTBOUND_FRAME_RATE_TRACE=\"%s\"\n", flow->getFlowID(), flow->getTrafficSpec().OutboundFrameRateTrace.c_str());
+         }
+         if(flow->getTrafficSpec().OutboundFrameSizeRng == RANDOM_TRACE) {
+            fprintf(configFile, "FLOW%u_OUTBOUND_FRAME_SIZE_TRACE=\"%s\"\n", flow->getFlowID(), flow->getTrafficSpec().OutboundFrameSizeTrace.c_str());
+         }
          for(unsigned int i = 0;i < NETPERFMETER_RNG_INPUT_PARAMETERS;i++) {
             fprintf(configFile, "FLOW%u_INBOUND_FRAME_RATE_VALUE%u=%f\n",   flow->getFlowID(), i + 1, flow->getTrafficSpec().InboundFrameRate[i]);
          }
@@ -405,6 +426,9 @@ bool performNetPerfMeterStart(MessageReader*         messageReader,
          fprintf(configFile, "FLOW%u_RELIABLE=%f\n",                         flow->getFlowID(), flow->getTrafficSpec().ReliableMode);
          fprintf(configFile, "FLOW%u_ORDERED=%f\n",                          flow->getFlowID(), flow->getTrafficSpec().OrderedMode);
          fprintf(configFile, "FLOW%u_NODELAY=\"%s\"\n",                      flow->getFlowID(), (flow->getTrafficSpec().NoDelay == true) ? "on" : "off");
+         fprintf(configFile, "FLOW%u_GSO=\"%s\"\n",                          flow->getFlowID(), (flow->getTrafficSpec().UseGSO == true) ? "on" : "off");
+         fprintf(configFile, "FLOW%u_ZEROCOPY=\"%s\"\n",                     flow->getFlowID(), (flow->getTrafficSpec().UseZeroCopy == true) ? "on" : "off");
+         fprintf(configFile, "FLOW%u_PACING=\"%s\"\n",                       flow->getFlowID(), FlowTrafficSpec::getPacingName(flow->getTrafficSpec().Pacing));
          fprintf(configFile, "FLOW%u_DEBUG=\"%s\"\n",                        flow->getFlowID(), (flow->getTrafficSpec().Debug == true) ? "on" : "off");
          fprintf(configFile, "FLOW%u_CC=\"%s\"\n",                           flow->getFlowID(), flow->getTrafficSpec().CongestionControl.c_str());
          fprintf(configFile, "FLOW%u_VECTOR_ACTIVE_NODE=\"%s\"\n",           flow->getFlowID(), flow->getVectorFile().getName().c_str());
@@ -825,6 +849,17 @@ static bool handleNetPerfMeterAddFlow(MessageReader*                    messageR
       trafficSpec.NoDelay                  = (addFlowMsg->Header.Flags & NPMAFF_NODELAY);
       trafficSpec.Debug                    = (addFlowMsg->Header.Flags & NPMAFF_DEBUG);
       trafficSpec.RepeatOnOff              = (addFlowMsg->Header.Flags & NPMAFF_REPEATONOFF);
+      trafficSpec.UseGSO                   = (addFlowMsg->Header.Flags & NPMAFF_GSO);
+      trafficSpec.UseZeroCopy              = (addFlowMsg->Header.Flags & NPMAFF_ZEROCOPY);
+      if(addFlowMsg->Header.Flags & NPMAFF_KERNELPACING) {
+         trafficSpec.Pacing = FlowTrafficSpec::KernelPacing;
+      }
+      else if(addFlowMsg->Header.Flags & NPMAFF_SPINPACING) {
+         trafficSpec.Pacing = FlowTrafficSpec::SpinPacing;
+      }
+      else if(addFlowMsg->Header.Flags & NPMAFF_PRECISEPACING) {
+         trafficSpec.Pacing = FlowTrafficSpec::PrecisePacing;
+      }
       trafficSpec.RetransmissionTrials     = be32toh(addFlowMsg->RetransmissionTrials) & ~NPMAF_RTX_TRIALS_IN_MILLISECONDS;
       trafficSpec.RetransmissionTrialsInMS = (be32toh(addFlowMsg->RetransmissionTrials) & NPMAF_RTX_TRIALS_IN_MILLISECONDS);
       if( (trafficSpec.RetransmissionTrialsInMS) && (trafficSpec.RetransmissionTrials == NPMAF_RTX_DEFAULT) ) {
@@ -1128,7 +1163,8 @@ bool handleNetPerfMeterIdentify(const NetPerfMeterIdentifyMessage* identifyMsg,
          flow->lock();
          const int  controlSocketDescriptor = flow->getControlSocketDescriptor();
          const bool vectorFileOkay          = flow->initializeVectorFile(nullptr, vectorFileFormat);
-         const bool socketConfigured        = flow->configureSocket(sd);
+         // NOTE: An incoming UDP flow may have got its own socket!
+         const bool socketConfigured        = flow->configureSocket(flow->getSocketDescriptor());
          const bool success                 = (vectorFileOkay && socketConfigured);
          flow->unlock();
          sendNetPerfMeterAcknowledge(controlSocketDescriptor,
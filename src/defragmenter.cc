@@ -30,6 +30,7 @@
 #include "assure.h"
 #include "defragmenter.h"
 
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
 #include <map>
@@ -41,27 +42,43 @@ Defragmenter::Defragmenter()
    NextFrameID         = 0;
    NextPacketSeqNumber = 0;
    NextByteSeqNumber   = 0;
+
+   Window.resize(DEFRAGMENTER_INITIAL_WINDOW);
+   for(size_t i = 0;i < Window.size();i++) {
+      Window[i].InUse = false;
+   }
+   WindowBase    = 0;
+   WindowEnd     = 0;
+   WindowFrames  = 0;
+   FreeFragments = NoFragment;
 }
 
 
 // ###### Destructor ########################################################
 Defragmenter::~Defragmenter()
 {
-   std::map<uint32_t, Frame*>::iterator frameIterator = FrameSet.begin();
-   while(frameIterator != FrameSet.end()) {
-      Frame* frame = frameIterator->second;
+}
 
-      std::map<uint64_t, Fragment*>::iterator fragmentIterator = frame->FragmentSet.begin();
-      while(fragmentIterator != frame->FragmentSet.end()) {
-         Fragment* fragment = fragmentIterator->second;
-         frame->FragmentSet.erase(fragmentIterator);
-         delete fragment;
-         fragmentIterator = frame->FragmentSet.begin();
-      }
 
-      FrameSet.erase(frameIterator);
-      delete frame;
-      frameIterator = FrameSet.begin();
+// ###### Print frame #######################################################
+void Defragmenter::printFrame(std::ostream& os, const Frame* frame)
+{
+   os << "   - Frame " << frame->FrameID
+      << ", LastUpdate=" << frame->LastUpdate
+      << ":\n";
+
+   for(uint32_t f = frame->FirstFragment;f != NoFragment;f = FragmentPool[f].Next) {
+      const Fragment* fragment = &FragmentPool[f];
+      os << "      + Fragment " << fragment->PacketSeqNumber << ":\t"
+         << "ByteSeq=" << fragment->ByteSeqNumber
+         << ", Length=" << fragment->Length << "   ";
+      if(fragment->Flags & NPMDF_FRAME_BEGIN) {
+         os << "<Begin> ";
+      }
+      if(fragment->Flags & NPMDF_FRAME_END) {
+         os << "<End> ";
+      }
+      os << "\n";
    }
 }
 
@@ -70,136 +87,164 @@ Defragmenter::~Defragmenter()
 void Defragmenter::print(std::ostream& os)
 {
    os << "FragmentSet:\n";
-   for(std::map<uint32_t, Frame*>::iterator frameIterator = FrameSet.begin();
-         frameIterator != FrameSet.end(); frameIterator++) {
-      Frame* frame = frameIterator->second;
-      os << "   - Frame " << frame->FrameID
-         << ", LastUpdate=" << frame->LastUpdate
-         << ":\n";
-
-      for(std::map<uint64_t, Fragment*>::iterator fragmentIterator = frame->FragmentSet.begin();
-          fragmentIterator != frame->FragmentSet.end(); fragmentIterator++) {
-         Fragment* fragment = fragmentIterator->second;
-         os << "      + Fragment " << fragment->PacketSeqNumber << ":\t"
-            << "ByteSeq=" << fragment->ByteSeqNumber
-            << ", Length=" << fragment->Length << "   ";
-         if(fragment->Flags & NPMDF_FRAME_BEGIN) {
-            os << "<Begin> ";
+   if(WindowFrames > 0) {
+      for(uint64_t frameID = WindowBase;frameID < WindowEnd;frameID++) {
+         const Frame* frame = &Window[frameID & (Window.size() - 1)];
+         if(frame->InUse) {
+            printFrame(os, frame);
          }
-         if(fragment->Flags & NPMDF_FRAME_END) {
-            os << "<End> ";
-         }
-         os << "\n";
       }
    }
+   for(std::map<uint32_t, Frame>::iterator frameIterator = OverflowSet.begin();
+       frameIterator != OverflowSet.end(); frameIterator++) {
+      printFrame(os, &frameIterator->second);
+   }
 }
 
 
-// ###### Add fragment to Defragmenter ######################################
-void Defragmenter::addFragment(const unsigned long long       now,
-                               const NetPerfMeterDataMessage* dataMsg)
+// ###### Grow ring to hold the given span of frame IDs #####################
+void Defragmenter::growWindow(const uint64_t span)
 {
-   const uint32_t frameID = be32toh(dataMsg->FrameID);
+   size_t newSize = Window.size();
+   while(newSize < span) {
+      newSize <<= 1;
+   }
 
-   // ====== Find frame =====================================================
-   Frame*                               frame;
-   std::map<uint32_t, Frame*>::iterator foundFrame = FrameSet.find(frameID);
-   if(foundFrame != FrameSet.end()) {
-      frame = foundFrame->second;
+   std::vector<Frame> newWindow(newSize);
+   for(size_t i = 0;i < newSize;i++) {
+      newWindow[i].InUse = false;
    }
-   else {
-      // ====== Frame has to be created =====================================
-      frame = new Frame;
-      if(frame) {
-         frame->LastUpdate = now;
-         frame->FrameID    = frameID;
-         frame->Completed  = false;
-         FrameSet.insert(std::pair<uint32_t, Frame*>(frame->FrameID, frame));
+   for(size_t i = 0;i < Window.size();i++) {
+      if(Window[i].InUse) {
+         newWindow[Window[i].FrameID & (newSize - 1)] = Window[i];
       }
    }
+   Window.swap(newWindow);
+}
 
-   // ====== Add fragment ===================================================
-   const uint64_t packetSeqNumber = be64toh(dataMsg->SeqNumber);
-   std::map<uint64_t, Fragment*>::iterator foundFragment =
-      frame->FragmentSet.find(packetSeqNumber);
-   if(foundFragment == frame->FragmentSet.end()) {
-      Fragment* fragment = new Fragment;
-      if(fragment) {
-         fragment->PacketSeqNumber = packetSeqNumber;
-         fragment->ByteSeqNumber   = be64toh(dataMsg->ByteSeqNumber);
-         fragment->Length          = be16toh(dataMsg->Header.Length);
-         fragment->Flags           = dataMsg->Header.Flags;
-         frame->FragmentSet.insert(std::pair<uint64_t, Fragment*>(fragment->PacketSeqNumber, fragment));
+
+// ###### Find frame, or create it ##########################################
+Defragmenter::Frame* Defragmenter::getFrame(const unsigned long long now,
+                                            const uint32_t           frameID)
+{
+   // ====== Look for frame outside of the ring =============================
+   if(!OverflowSet.empty()) {
+      std::map<uint32_t, Frame>::iterator found = OverflowSet.find(frameID);
+      if(found != OverflowSet.end()) {
+         return &found->second;
       }
    }
-   else {
-      // puts("Duplicate???");
+
+   // ====== Ensure that the ring covers the frame ID =======================
+   // The frame IDs in the ring must span at most the ring size. Then, each
+   // frame has its own slot. The ring only grows forwards: a stale or
+   // duplicate packet of an old frame (e.g. already accounted by purge())
+   // must not let it grow to the maximum window.
+   uint64_t base = frameID;
+   uint64_t end  = (uint64_t)frameID + 1;
+   if(WindowFrames > 0) {
+      base = std::min(base, WindowBase);
+      end  = std::max(end, WindowEnd);
    }
+   if(end - base > Window.size()) {
+      if( ((WindowFrames > 0) && (frameID < WindowBase)) ||
+          (end - base > DEFRAGMENTER_MAXIMUM_WINDOW) ) {
+         // ====== Frame has to be stored outside of the ring ===============
+         Frame& frame        = OverflowSet[frameID];
+         frame.FrameID       = frameID;
+         frame.InUse         = true;
+         frame.LastUpdate    = now;
+         frame.FirstFragment = NoFragment;
+         frame.LastFragment  = NoFragment;
+         return &frame;
+      }
+      growWindow(end - base);
+   }
+   WindowBase = base;
+   WindowEnd  = end;
+
+   // ====== Find frame in ring, or create it ===============================
+   Frame* frame = &Window[frameID & (Window.size() - 1)];
+   if(!frame->InUse) {
+      frame->FrameID       = frameID;
+      frame->InUse         = true;
+      frame->LastUpdate    = now;
+      frame->FirstFragment = NoFragment;
+      frame->LastFragment  = NoFragment;
+      WindowFrames++;
+   }
+   return frame;
 }
 
 
-// ====== Get first fragment from storage ===================================
-bool Defragmenter::getFirstFragment(Frame*&    frame,
-                                    Fragment*& fragment)
+// ###### Allocate fragment from pool #######################################
+uint32_t Defragmenter::allocateFragment()
 {
-   FrameIterator = FrameSet.begin();
-   if(FrameIterator != FrameSet.end()) {
-      frame            = FrameIterator->second;
-      FragmentIterator = frame->FragmentSet.begin();
-      assure(FragmentIterator != frame->FragmentSet.end());
-      fragment = FragmentIterator->second;
-      return true;
-   }
-   frame    = nullptr;
-   fragment = nullptr;
-   return false;
+   if(FreeFragments == NoFragment) {
+      // ====== Grow pool ===================================================
+      const size_t oldSize = FragmentPool.size();
+      const size_t newSize = std::max(2 * oldSize, (size_t)DEFRAGMENTER_INITIAL_FRAGMENTS);
+      assure(newSize < NoFragment);
+      FragmentPool.resize(newSize);
+      for(size_t i = newSize;i > oldSize;i--) {
+         FragmentPool[i - 1].Next = FreeFragments;
+         FreeFragments = (uint32_t)(i - 1);
+      }
+   }
+   const uint32_t f = FreeFragments;
+   FreeFragments = FragmentPool[f].Next;
+   return f;
 }
 
 
-// ====== Get next fragment from storage ====================================
-bool Defragmenter::getNextFragment(Frame*&    frame,
-                                   Fragment*& fragment,
-                                   const bool eraseCurrentFrame)
+// ###### Add fragment to Defragmenter ######################################
+void Defragmenter::addFragment(const unsigned long long       now,
+                               const NetPerfMeterDataMessage* dataMsg)
 {
-   Frame*                                  lastFrame            = frame;
-   Fragment*                               lastFragment         = fragment;
-   std::map<uint32_t, Frame*>::iterator    lastFrameIterator    = FrameIterator;
-   std::map<uint64_t, Fragment*>::iterator lastFragmentIterator = FragmentIterator;
-
-   FragmentIterator++;
-   if(FragmentIterator == frame->FragmentSet.end()) {
-      FrameIterator++;
-      if(FrameIterator == FrameSet.end()) {
-         frame    = nullptr;
-         fragment = nullptr;
+   const uint32_t frameID         = be32toh(dataMsg->FrameID);
+   const uint64_t packetSeqNumber = be64toh(dataMsg->SeqNumber);
+
+   // ====== Find frame =====================================================
+   Frame* frame = getFrame(now, frameID);
+
+   // ====== Find position of fragment ======================================
+   // Usually, the fragment is appended to the frame. Otherwise, the
+   // fragment list is searched for its position.
+   uint32_t previous = frame->LastFragment;
+   uint32_t next     = NoFragment;
+   if( (previous != NoFragment) &&
+       (FragmentPool[previous].PacketSeqNumber >= packetSeqNumber) ) {
+      previous = NoFragment;
+      next     = frame->FirstFragment;
+      while( (next != NoFragment) &&
+             (FragmentPool[next].PacketSeqNumber < packetSeqNumber) ) {
+         previous = next;
+         next     = FragmentPool[next].Next;
       }
-      else {
-         frame            = FrameIterator->second;
-         FragmentIterator = frame->FragmentSet.begin();
-         assure(FragmentIterator != frame->FragmentSet.end());
-         fragment = FragmentIterator->second;
+      if( (next != NoFragment) &&
+          (FragmentPool[next].PacketSeqNumber == packetSeqNumber) ) {
+         // puts("Duplicate???");
+         return;
       }
    }
+
+   // ====== Add fragment ===================================================
+   const uint32_t f           = allocateFragment();
+   Fragment*      fragment    = &FragmentPool[f];
+   fragment->PacketSeqNumber = packetSeqNumber;
+   fragment->ByteSeqNumber   = be64toh(dataMsg->ByteSeqNumber);
+   fragment->Length          = be16toh(dataMsg->Header.Length);
+   fragment->Flags           = dataMsg->Header.Flags;
+   fragment->Next            = next;
+   if(previous != NoFragment) {
+      FragmentPool[previous].Next = f;
+   }
    else {
-      fragment = FragmentIterator->second;
+      frame->FirstFragment = f;
    }
-
-   if(eraseCurrentFrame) {
-      lastFrame->FragmentSet.erase(lastFragmentIterator);
-      delete lastFragment;
-      if(lastFrame->FragmentSet.size() == 0) {
-         FrameSet.erase(lastFrameIterator);
-         delete lastFrame;
-         if(lastFrame == frame) {   // Ensure reference gets invalidated!
-            frame = nullptr;
-         }
-      }
-      if(lastFragment == fragment) {   // Ensure reference gets invalidated!
-         fragment = nullptr;
-      }
+   if(next == NoFragment) {
+      frame->LastFragment = f;
    }
-
-   return ((frame != nullptr) && (fragment != nullptr));
 }
 
 
@@ -216,31 +261,63 @@ void Defragmenter::purge(const unsigned long long now,
    lostPackets    = 0;
    lostFrames     = 0;
 
-   Frame*    frame;
-   Fragment* fragment;
-   if(getFirstFragment(frame, fragment)) {
-      bool eraseCurrentFragment;
-      do {
-         if(frame->LastUpdate + defragmentTimeout <= now) {
-            eraseCurrentFragment = true;
-
-            if(frame->FrameID >= NextFrameID) {
-               receivedFrames++;
-               lostFrames += ((unsigned long long)frame->FrameID - (unsigned long long)NextFrameID);
-               NextFrameID = frame->FrameID + 1;
-            }
-            if(fragment->ByteSeqNumber >= NextByteSeqNumber) {
-               lostBytes += ((unsigned long long)fragment->ByteSeqNumber - (unsigned long long)NextByteSeqNumber);
-               NextByteSeqNumber = fragment->ByteSeqNumber + fragment->Length;
-            }
-            if(fragment->PacketSeqNumber >= NextPacketSeqNumber) {
-               lostPackets += ((unsigned long long)fragment->PacketSeqNumber - (unsigned long long)NextPacketSeqNumber);
-               NextPacketSeqNumber = fragment->PacketSeqNumber + 1;
-            }
+   for(;;) {
+      // ====== Get frame with lowest frame ID ==============================
+      Frame* frame = nullptr;
+      if(WindowFrames > 0) {
+         while(!Window[WindowBase & (Window.size() - 1)].InUse) {
+            WindowBase++;
          }
-         else {
-            break;
+         frame = &Window[WindowBase & (Window.size() - 1)];
+      }
+      const bool inWindow = (frame != nullptr) &&
+                            ( (OverflowSet.empty()) ||
+                              (frame->FrameID < OverflowSet.begin()->first) );
+      if(!inWindow) {
+         frame = (OverflowSet.empty()) ? nullptr : &OverflowSet.begin()->second;
+      }
+      if( (frame == nullptr) ||
+          (frame->LastUpdate + defragmentTimeout > now) ) {
+         break;
+      }
+
+      // ====== Account the frame's fragments ===============================
+      for(uint32_t f = frame->FirstFragment;f != NoFragment;f = FragmentPool[f].Next) {
+         const Fragment* fragment = &FragmentPool[f];
+         if(frame->FrameID >= NextFrameID) {
+            receivedFrames++;
+            lostFrames += ((unsigned long long)frame->FrameID - (unsigned long long)NextFrameID);
+            NextFrameID = frame->FrameID + 1;
          }
-      } while(getNextFragment(frame, fragment, eraseCurrentFragment));
+         if(fragment->ByteSeqNumber >= NextByteSeqNumber) {
+            lostBytes += ((unsigned long long)fragment->ByteSeqNumber - (unsigned long long)NextByteSeqNumber);
+            NextByteSeqNumber = fragment->ByteSeqNumber + fragment->Length;
+         }
+         if(fragment->PacketSeqNumber >= NextPacketSeqNumber) {
+            lostPackets += ((unsigned long long)fragment->PacketSeqNumber - (unsigned long long)NextPacketSeqNumber);
+            NextPacketSeqNumber = fragment->PacketSeqNumber + 1;
+         }
+      }
+
+      // ====== Remove the frame ============================================
+      FragmentPool[frame->LastFragment].Next = FreeFragments;
+      FreeFragments = frame->FirstFragment;
+      if(inWindow) {
+         frame->InUse = false;
+         WindowFrames--;
+         WindowBase++;
+      }
+      else {
+         OverflowSet.erase(OverflowSet.begin());
+      }
+   }
+
+   // ====== Shrink the ring, if it is empty ================================
+   if( (WindowFrames == 0) && (Window.size() > DEFRAGMENTER_INITIAL_WINDOW) ) {
+      std::vector<Frame> newWindow(DEFRAGMENTER_INITIAL_WINDOW);
+      for(size_t i = 0;i < newWindow.size();i++) {
+         newWindow[i].InUse = false;
+      }
+      Window.swap(newWindow);
    }
 }
@@ -31,10 +31,18 @@
 #define DEFRAGMENTER_H
 
 #include <map>
+#include <vector>
 
 #include "netperfmeterpackets.h"
 
 
+// The frames are stored in a ring indexed by frame ID. The ring grows up
+// to the maximum window; frames outside of it are stored in a map.
+#define DEFRAGMENTER_INITIAL_WINDOW    64
+#define DEFRAGMENTER_MAXIMUM_WINDOW    (1 << 22)
+#define DEFRAGMENTER_INITIAL_FRAGMENTS 256
+
+
 class Defragmenter
 {
    // ====== Public Methods =================================================
@@ -56,33 +64,41 @@ class Defragmenter
 
    // ====== Private Data ===================================================
    private:
+   static const uint32_t NoFragment = ~0U;
+
    struct Fragment
    {
       uint64_t PacketSeqNumber;
       uint64_t ByteSeqNumber;
+      uint32_t Next;   // Next fragment of frame, or next free fragment
       uint16_t Length;
       uint8_t  Flags;
    };
    struct Frame
    {
-      uint32_t                      FrameID;
-      unsigned long long            LastUpdate;
-      std::map<uint64_t, Fragment*> FragmentSet;
-      bool                          Completed;
+      uint32_t           FrameID;
+      bool               InUse;
+      unsigned long long LastUpdate;
+      uint32_t           FirstFragment;   // Fragment list, ordered by
+      uint32_t           LastFragment;    // packet sequence number
    };
 
-   bool getFirstFragment(Frame*&    frame,
-                         Fragment*& fragment);
-   bool getNextFragment(Frame*&    frame,
-                        Fragment*& fragment,
-                        const bool eraseCurrentFrame);
-
-   std::map<uint32_t, Frame*>              FrameSet;
-   std::map<uint32_t, Frame*>::iterator    FrameIterator;
-   std::map<uint64_t, Fragment*>::iterator FragmentIterator;
-   uint64_t                                NextPacketSeqNumber;
-   uint64_t                                NextByteSeqNumber;
-   uint32_t                                NextFrameID;
+   Frame* getFrame(const unsigned long long now,
+                   const uint32_t           frameID);
+   void growWindow(const uint64_t span);
+   uint32_t allocateFragment();
+   void printFrame(std::ostream& os, const Frame* frame);
+
+   std::vector<Frame>        Window;          // Ring of frames
+   uint64_t                  WindowBase;      // Lowest frame ID in ring
+   uint64_t                  WindowEnd;       // Highest frame ID in ring + 1
+   size_t                    WindowFrames;    // Number of frames in ring
+   std::map<uint32_t, Frame> OverflowSet;     // Frames outside of the ring
+   std::vector<Fragment>     FragmentPool;
+   uint32_t                  FreeFragments;   // Free list of fragment pool
+   uint64_t                  NextPacketSeqNumber;
+   uint64_t                  NextByteSeqNumber;
+   uint32_t                  NextFrameID;
 };
 
 #endif
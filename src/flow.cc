@@ -34,7 +34,12 @@
 #include "transfer.h"
 
 #include <cstring>
+#if defined(__linux__)
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+#endif
 #include <netinet/tcp.h>
+#include <netinet/udp.h>
 #include <signal.h>
 #include <sstream>
 
@@ -50,10 +55,42 @@ Flow::Flow(const uint64_t         measurementID,
    FlowID                   = flowID;
    StreamID                 = streamID;
 
+   // The identification fields of outgoing NETPERFMETER_DATA messages never
+   // change. Serialise them once; only the per-message fields get patched.
+   memset(&DataHeaderTemplate, 0, sizeof(DataHeaderTemplate));
+   DataHeaderTemplate.Header.Type   = NETPERFMETER_DATA;
+   DataHeaderTemplate.MeasurementID = htobe64(MeasurementID);
+   DataHeaderTemplate.FlowID        = htobe32(FlowID);
+   DataHeaderTemplate.StreamID      = htobe16(StreamID);
+
+   // The flow's random stream is derived from the seed (or, without seed,
+   // from the random measurement ID) and its identification. The direction
+   // is part of the key, since both sides of a flow have the same IDs, but
+   // must not draw the same outbound sequences.
+   uint64_t seed;
+   if(!FlowManager::getFlowManager()->getRandomSeed(seed)) {
+      seed = MeasurementID;
+   }
+   seedFastRandom(mixBits64(mixBits64(mixBits64(seed) ^
+                                      (((uint64_t)FlowID << 16) | (uint64_t)StreamID)) ^
+                            ((controlSocketDescriptor != -1) ? 1 : 0)),
+                  &RandomStream);
+   initRandomValueBuffer(&OutboundFrameRateValues);
+   initRandomValueBuffer(&OutboundFrameSizeValues);
+   if(trafficSpec.OutboundFrameRateRng == RANDOM_TRACE) {
+      OutboundFrameRateTrace.open(trafficSpec.OutboundFrameRateTrace);
+   }
+   if(trafficSpec.OutboundFrameSizeRng == RANDOM_TRACE) {
+      OutboundFrameSizeTrace.open(trafficSpec.OutboundFrameSizeTrace);
+   }
+
    SocketDescriptor         = -1;
    OriginalSocketDescriptor = false;
    ControlSocketDescriptor  = controlSocketDescriptor;
    RemoteAddressIsValid     = false;
+   IndexedSocketDescriptor  = -1;
+   IndexedRemoteAddress     = false;
+   IndexedSocketHandler     = false;
 
    InputStatus              = WaitingForStartup;
    OutputStatus             = WaitingForStartup;
@@ -70,7 +107,24 @@ Flow::Flow(const uint64_t         measurementID,
    LastOutboundSeqNumber    = ~0ULL;
    LastOutboundFrameID      = ~0U;
    NextStatusChangeEvent    = ~0ULL;
+   NextTransmissionEvent    = ~0ULL;
+   LastTransmissionEvent    = 0;
+   NextTransmissionInterval = ~0ULL;
+   KernelPaced              = false;
+   UseTxTime                = false;
+   TxTime                   = 0;
+   ZeroCopy                 = false;
+   ZeroCopyCopied           = false;
+   UseGSO                   = trafficSpec.UseGSO;
+   GSOSegmentSize           = 0;
+   ZeroCopySent             = 0;
+   ZeroCopyCompleted        = 0;
+   ZeroCopyHeaders          = nullptr;
+   ZeroCopyDone             = nullptr;
+   configureTransmission(this);
    OnOffEventPointer        = 0;
+   Sender                   = nullptr;
+   TimerWheel::initTimer(&SenderTimer, this);
 
    FlowManager::getFlowManager()->addFlow(this);
 }
@@ -84,10 +138,12 @@ Flow::~Flow()
    VectorFile.finish(true);
    if((SocketDescriptor >= 0) && (OriginalSocketDescriptor)) {
       if(DeleteWhenFinished) {
-         FlowManager::getFlowManager()->getMessageReader()->deregisterSocket(SocketDescriptor);
+         FlowManager::getFlowManager()->getMessageReader(SocketDescriptor)->deregisterSocket(SocketDescriptor);
          ext_close(SocketDescriptor);
       }
    }
+   delete [] ZeroCopyHeaders;
+   delete [] ZeroCopyDone;
 }
 
 
@@ -99,6 +155,9 @@ void Flow::resetStatistics()
    LastBandwidthStats.reset();
    Jitter = 0;
    Delay  = 0;
+   ScheduleErrorFrames  = 0;
+   ScheduleErrorSum     = 0;
+   ScheduleErrorMaximum = 0;
    unlock();
 }
 
@@ -147,9 +206,9 @@ void Flow::print(std::ostream& os, const bool printStatistics)
 
 
    if(printStatistics) {
-      CurrentBandwidthStats.print(ss,
-                                  (LastTransmission - FirstTransmission) / 1000000.0,
-                                  (LastReception    - FirstReception)    / 1000000.0);
+      CurrentBandwidthStats.getStats().print(ss,
+         (getLastTransmission() - getFirstTransmission()) / 1000000.0,
+         (getLastReception()    - getFirstReception())    / 1000000.0);
    }
    unlock();
 
@@ -170,10 +229,15 @@ void Flow::setSocketDescriptor(const int  socketDescriptor,
    DeleteWhenFinished       = deleteWhenFinished;
 
    if(SocketDescriptor >= 0) {
-      FlowManager::getFlowManager()->getMessageReader()->registerSocket(
+      FlowManager::getFlowManager()->getMessageReader(SocketDescriptor)->registerSocket(
          TrafficSpec.Protocol, SocketDescriptor, false);
    }
    unlock();
+
+   FlowManager::getFlowManager()->updateFlowIndex(this);
+   if(socketDescriptor >= 0) {
+      FlowManager::getFlowManager()->updatePollSocket(socketDescriptor);
+   }
 }
 
 
@@ -198,27 +262,26 @@ bool Flow::initializeVectorFile(const char* name, const OutputFileFormat format)
 
 
 // ###### Update transmission statistics ####################################
+// The statistics are updated without locking, i.e. the sender never blocks
+// on the statistics output.
 void Flow::updateTransmissionStatistics(const unsigned long long now,
                                         const size_t             addedFrames,
                                         const size_t             addedPackets,
                                         const size_t             addedBytes)
 {
-   lock();
-
    // ====== Update statistics ==============================================
-   LastTransmission = now;
-   if(FirstTransmission == 0) {
-      FirstTransmission = now;
+   LastTransmission.store(now, std::memory_order_relaxed);
+   if(FirstTransmission.load(std::memory_order_relaxed) == 0) {
+      unsigned long long unset = 0;
+      FirstTransmission.compare_exchange_strong(unset, now, std::memory_order_relaxed);
    }
-   CurrentBandwidthStats.TransmittedFrames  += addedFrames;
-   CurrentBandwidthStats.TransmittedPackets += addedPackets;
-   CurrentBandwidthStats.TransmittedBytes   += addedBytes;
-
-   unlock();
+   CurrentBandwidthStats.addTransmitted(addedFrames, addedPackets, addedBytes);
 }
 
 
 // ###### Update reception statistics #######################################
+// NOTE: The caller has to hold the lock of the ReceiverThread of the
+//       flow's socket, i.e. there is only one writer at a time.
 void Flow::updateReceptionStatistics(const unsigned long long now,
                                      const size_t             addedFrames,
                                      const size_t             addedBytes,
@@ -230,38 +293,37 @@ void Flow::updateReceptionStatistics(const unsigned long long now,
                                      const double             delayDiff,
                                      const double             jitter)
 {
-   lock();
-
    // ====== Update statistics ==============================================
-   LastReception = now;
-   if(FirstReception == 0) {
-      FirstReception = now;
-   }
-   CurrentBandwidthStats.ReceivedFrames  += addedFrames;
-   CurrentBandwidthStats.ReceivedPackets++;
-   CurrentBandwidthStats.ReceivedBytes   += addedBytes;
-   CurrentBandwidthStats.LostFrames      += lostFrames;
-   CurrentBandwidthStats.LostPackets     += lostPackets;
-   CurrentBandwidthStats.LostBytes       += lostBytes;
-   Delay  = delay;
-   Jitter = jitter;
+   LastReception.store(now, std::memory_order_relaxed);
+   if(FirstReception.load(std::memory_order_relaxed) == 0) {
+      unsigned long long unset = 0;
+      FirstReception.compare_exchange_strong(unset, now, std::memory_order_relaxed);
+   }
+   CurrentBandwidthStats.addReceived(addedFrames, 1, addedBytes,
+                                     lostFrames, lostPackets, lostBytes);
+   Delay.store(delay, std::memory_order_relaxed);
+   Jitter.store(jitter, std::memory_order_relaxed);
 
    // ====== Write line to flow's vector file ===============================
-   if( (MyMeasurement) && (MyMeasurement->getFirstStatisticsEvent() > 0) ) {
-      VectorFile.printf(
-         "%06llu\t%llu\t%1.6f\t%llu\t"
-         "%llu\t%llu\t%llu\t"
-         "%u\t%u\t%u\t"
-         "%1.3f\t%1.3f\t%1.3f\n",
-         VectorFile.nextLine(), now,
-         (double)(now - MyMeasurement->getFirstStatisticsEvent()) / 1000000.0,
-         seqNumber,
-         CurrentBandwidthStats.ReceivedBytes, CurrentBandwidthStats.ReceivedPackets, CurrentBandwidthStats.ReceivedFrames,
-         addedBytes, 1, addedFrames,
-         delay, delayDiff, jitter);
+   // The vector file is part of the reception state, i.e. it is protected
+   // by the lock of the flow's ReceiverThread, held by the caller.
+   if(VectorFile.exists()) {
+      if( (MyMeasurement) && (MyMeasurement->getFirstStatisticsEvent() > 0) ) {
+         VectorFile.printf(
+            "%06llu\t%llu\t%1.6f\t%llu\t"
+            "%llu\t%llu\t%llu\t"
+            "%u\t%u\t%u\t"
+            "%1.3f\t%1.3f\t%1.3f\n",
+            VectorFile.nextLine(), now,
+            (double)(now - MyMeasurement->getFirstStatisticsEvent()) / 1000000.0,
+            seqNumber,
+            CurrentBandwidthStats.ReceivedBytes.load(std::memory_order_relaxed),
+            CurrentBandwidthStats.ReceivedPackets.load(std::memory_order_relaxed),
+            CurrentBandwidthStats.ReceivedFrames.load(std::memory_order_relaxed),
+            addedBytes, 1, addedFrames,
+            delay, delayDiff, jitter);
+      }
    }
-
-   unlock();
 }
 
 
@@ -270,6 +332,27 @@ bool Flow::activate()
 {
    deactivate();
    assure(SocketDescriptor >= 0);
+
+   // ====== Use a sender thread of the pool, if configured =================
+   // NOTE: A saturated sender keeps its own thread, since its blocking
+   //       sends would delay all other flows of the sender thread.
+   //       A precisely paced flow keeps its own thread as well, since it
+   //       sleeps (or spins) exactly until its own next transmission.
+   if( (!TrafficSpec.outgoingFlowIsSaturated()) &&
+       (TrafficSpec.Pacing == FlowTrafficSpec::DefaultPacing) ) {
+      SenderThread* senderThread = FlowManager::getFlowManager()->getSenderThread();
+      if(senderThread != nullptr) {
+         lock();
+         Sender = senderThread;
+         scheduleNextStatusChangeEvent(getMicroTime());
+         const unsigned long long nextEvent = scheduleNextEvent();
+         unlock();
+         senderThread->addFlow(this, nextEvent);
+         return true;
+      }
+   }
+
+   // ====== Use own thread =================================================
    return start();
 }
 
@@ -277,11 +360,13 @@ bool Flow::activate()
 // ###### Stop flow's transmission thread ###################################
 void Flow::deactivate(const bool asyncStop)
 {
-   if(isRunning()) {
+   lock();
+   SenderThread* senderThread = Sender;
+   unlock();
+   if( (isRunning()) || (senderThread != nullptr) ) {
       lock();
       InputStatus  = Off;
       OutputStatus = Off;
-      PollFDEntry  = nullptr;   // Poll FD entry is now invalid!
       unlock();
       if(SocketDescriptor >= 0) {
          if(TrafficSpec.Protocol == IPPROTO_UDP) {
@@ -293,10 +378,22 @@ void Flow::deactivate(const bool asyncStop)
             ext_shutdown(SocketDescriptor, (TrafficSpec.Protocol == IPPROTO_TCP) ? SHUT_WR : SHUT_RDWR);
          }
       }
-      stop();
+      if(senderThread != nullptr) {
+         // NOTE: On asynchronous stop, the sender thread may still handle
+         //       the flow. The final deactivate() call waits for this.
+         senderThread->removeFlow(this, !asyncStop);
+         if(!asyncStop) {
+            lock();
+            Sender = nullptr;
+            unlock();
+         }
+      }
+      else {
+         stop();
+      }
       if(!asyncStop) {
          waitForFinish();
-         FlowManager::getFlowManager()->getMessageReader()->deregisterSocket(SocketDescriptor);
+         FlowManager::getFlowManager()->getMessageReader(SocketDescriptor)->deregisterSocket(SocketDescriptor);
       }
    }
 }
@@ -315,9 +412,27 @@ unsigned long long Flow::scheduleNextTransmissionEvent()
       }
       // ====== Non-saturated sender ========================================
       else if( (TrafficSpec.OutboundFrameSize[0] > 0.0) && (TrafficSpec.OutboundFrameRate[0] > 0.0000001) ) {
-         const double nextFrameRate = getRandomValue((const double*)&TrafficSpec.OutboundFrameRate,
-                                                     TrafficSpec.OutboundFrameRateRng);
-         nextTransmissionEvent = LastTransmission + (unsigned long long)rint(1000000.0 / nextFrameRate);
+         // The inter-frame time is drawn once per frame, in order to keep
+         // the flow's random stream independent of the number of wake-ups.
+         if( (NextTransmissionInterval == ~0ULL) &&
+             (TrafficSpec.OutboundFrameRateRng == RANDOM_TRACE) ) {
+            NextTransmissionInterval = OutboundFrameRateTrace.nextInterArrivalTime();
+         }
+         else if(NextTransmissionInterval == ~0ULL) {
+            const double nextFrameRate = getBufferedRandomValue(&OutboundFrameRateValues,
+                                                                (const double*)&TrafficSpec.OutboundFrameRate,
+                                                                TrafficSpec.OutboundFrameRateRng,
+                                                                &RandomStream);
+            NextTransmissionInterval = (unsigned long long)rint(1000000.0 / nextFrameRate);
+         }
+         // Precise pacing schedules relative to the previous frame's
+         // scheduled time, in order to avoid accumulating the send delays.
+         // After a gap of more than 1s, it restarts from the actual time.
+         const unsigned long long base =
+            ( (TrafficSpec.Pacing != FlowTrafficSpec::DefaultPacing) &&
+              (getLastTransmission() - LastTransmissionEvent <= 1000000) ) ?
+               LastTransmissionEvent : getLastTransmission();
+         nextTransmissionEvent = base + NextTransmissionInterval;
       }
    }
    unlock();
@@ -340,7 +455,7 @@ unsigned long long Flow::scheduleNextStatusChangeEvent(const unsigned long long
 
    if(OnOffEventPointer < TrafficSpec.OnOffEvents.size()) {
       const OnOffEvent&        event        = TrafficSpec.OnOffEvents[OnOffEventPointer];
-      const unsigned long long relNextEvent = (unsigned long long)rint(1000000.0 * getRandomValue((const double*)&event.ValueArray, event.RandNumGen));
+      const unsigned long long relNextEvent = (unsigned long long)rint(1000000.0 * getRandomValue((const double*)&event.ValueArray, event.RandNumGen, &RandomStream));
       const unsigned long long absNextEvent = TimeBase + TimeOffset + relNextEvent;
 
       TimeOffset            = TimeOffset + relNextEvent;
@@ -382,6 +497,90 @@ void Flow::handleStatusChangeEvent(const unsigned long long now)
 }
 
 
+// ###### Schedule next transmission or status change event #################
+unsigned long long Flow::scheduleNextEvent()
+{
+   lock();
+   NextTransmissionEvent = scheduleNextTransmissionEvent();
+   const unsigned long long nextEvent = std::min(NextStatusChangeEvent,
+                                                 NextTransmissionEvent);
+   unlock();
+   return nextEvent;
+}
+
+
+// ###### Handle transmission and status change events ######################
+// Returns false, if the flow's transmission has failed.
+bool Flow::handleNextEvent(const unsigned long long now)
+{
+   bool result = true;
+
+   // ====== Send outgoing data =============================================
+   lock();
+   const FlowStatus outputStatus = OutputStatus;
+   unlock();
+   if(outputStatus == Flow::On) {
+      // ====== Outgoing data (saturated sender) ============================
+      if(TrafficSpec.outgoingFlowIsSaturated()) {
+         result = transmitFrame(this, now);
+      }
+
+      // ====== Outgoing data (non-saturated sender) ========================
+      else if(TrafficSpec.outgoingFlowIsNotSaturated()) {
+         // With kernel pacing, frames are handed to the kernel ahead of
+         // their scheduled time, which the kernel then enforces.
+         const unsigned long long lastEvent = getLastTransmission();
+         const unsigned long long horizon   = (KernelPaced) ? now + FLOW_KERNEL_PACING_LEAD_TIME : now;
+         unsigned long long       deadline  = NextTransmissionEvent;
+         if(deadline <= horizon) {
+            do {
+               // ====== Record schedule error ==============================
+               // The time is taken for each frame, since the preceding
+               // frames of a catch-up have already taken their time.
+               const unsigned long long sendTime = getMicroTime();
+               lock();
+               if((long long)(now - lastEvent) <= 1000000) {
+                  const unsigned long long scheduleError = (sendTime > deadline) ? sendTime - deadline : 0;
+                  ScheduleErrorFrames++;
+                  ScheduleErrorSum += scheduleError;
+                  if(scheduleError > ScheduleErrorMaximum) {
+                     ScheduleErrorMaximum = scheduleError;
+                  }
+               }
+               LastTransmissionEvent    = deadline;
+               NextTransmissionInterval = ~0ULL;   // To be drawn for next frame
+               TxTime                   = std::max(now, deadline);
+               unlock();
+
+               // A frame handed to the kernel ahead of time carries its
+               // scheduled time as send time stamp.
+               result = transmitFrame(this, (KernelPaced) ? TxTime : now);
+               if((long long)(now - lastEvent) > 1000000) {
+                  // Time gap of more than 1s -> do not try to correct.
+                  // But the next transmission needs to be scheduled!
+                  scheduleNextTransmissionEvent();
+                  break;
+               }
+               deadline = scheduleNextTransmissionEvent();
+            } while(deadline <= horizon);
+
+            if(TrafficSpec.Protocol == IPPROTO_UDP) {
+               // Keep sending, even if there is a temporary failure.
+               result = true;
+            }
+         }
+      }
+   }
+
+   // ====== Handle status changes ==========================================
+   if(NextStatusChangeEvent <= now) {
+      handleStatusChangeEvent(now);
+   }
+
+   return result;
+}
+
+
 // ###### Flow's transmission thread function ###############################
 void Flow::run()
 {
@@ -391,55 +590,46 @@ void Flow::run()
 
    bool result = true;
    do {
-      // ====== Schedule next status change event ===========================
-      unsigned long long       now              = getMicroTime();
-      const unsigned long long nextTransmission = scheduleNextTransmissionEvent();
-      unsigned long long       nextEvent        = std::min(NextStatusChangeEvent, nextTransmission);
+      // ====== Schedule next event =========================================
+      unsigned long long       now       = getMicroTime();
+      const unsigned long long nextEvent = scheduleNextEvent();
 
       // ====== Wait until there is something to do =========================
       if(nextEvent > now) {
-         int timeout = pollTimeout(now, 2,
-                                   now + 1000000,
-                                   nextEvent);
-         ext_poll_wrapper(nullptr, 0, timeout);
-         now = getMicroTime();
-      }
-
-      // ====== Send outgoing data ==========================================
-      lock();
-      const FlowStatus outputStatus = OutputStatus;
-      unlock();
-      if(outputStatus == Flow::On) {
-         // ====== Outgoing data (saturated sender) =========================
-         if(TrafficSpec.outgoingFlowIsSaturated()) {
-            result = transmitFrame(this, now);
-         }
-
-         // ====== Outgoing data (non-saturated sender) =====================
-         else if(TrafficSpec.outgoingFlowIsNotSaturated()) {
-            const unsigned long long lastEvent = LastTransmission;
-            if(nextTransmission <= now) {
-               do {
-                  result = transmitFrame(this, now);
-                  if(now - lastEvent > 1000000) {
-                     // Time gap of more than 1s -> do not try to correct.
-                     // But the next transmission needs to be scheduled!
-                     scheduleNextTransmissionEvent();
-                     break;
-                  }
-               } while(scheduleNextTransmissionEvent() <= now);
-
-               if(TrafficSpec.Protocol == IPPROTO_UDP) {
-                  // Keep sending, even if there is a temporary failure.
-                  result = true;
-               }
+         if(KernelPaced) {
+            // The kernel enforces the transmission schedule
+            // -> just wake up early enough to hand over the next frame.
+            lock();
+            const unsigned long long wakeUpTime =
+               std::min(NextStatusChangeEvent,
+                        NextTransmissionEvent - std::min(NextTransmissionEvent,
+                                                         (unsigned long long)FLOW_KERNEL_PACING_LEAD_TIME));
+            unlock();
+            if(wakeUpTime > now) {
+               waitUntil(std::min(wakeUpTime, now + 1000000));
             }
          }
+         else if( (TrafficSpec.Pacing != FlowTrafficSpec::DefaultPacing) &&
+                  (nextEvent - now <= 1000000) ) {
+            waitUntil(nextEvent,
+                      (TrafficSpec.Pacing == FlowTrafficSpec::SpinPacing) ?
+                         FLOW_PACING_SPIN_TIME : 0);
+         }
+         else {
+            int timeout = pollTimeout(now, 2,
+                                      now + 1000000,
+                                      nextEvent);
+            ext_poll_wrapper(nullptr, 0, timeout);
+         }
+         now = getMicroTime();
       }
 
-      // ====== Handle status changes =======================================
-      if(NextStatusChangeEvent <= now) {
-         handleStatusChangeEvent(now);
+      // ====== Handle events ===============================================
+      result = handleNextEvent(now);
+
+      // ====== Reap zero-copy completions ==================================
+      if(ZeroCopy) {
+         reapZeroCopyCompletions();
       }
    } while( (result == true) && (!isStopping()) );
 }
@@ -484,6 +674,28 @@ bool Flow::configureSocket(const int socketDescriptor)
                           congestionControl, socketDescriptor) << "\n";
          LOG_END
          return false;
+#endif
+      }
+   }
+   else if(TrafficSpec.Protocol == IPPROTO_UDP) {
+      if(TrafficSpec.UseGSO) {
+#if defined(UDP_SEGMENT)
+         // The segment size is set per message. Just check kernel support:
+         int       gsoSize;
+         socklen_t gsoSizeLength = sizeof(gsoSize);
+         if(ext_getsockopt(socketDescriptor, SOL_UDP, UDP_SEGMENT, &gsoSize, &gsoSizeLength) < 0) {
+            LOG_ERROR
+            stdlog << format("GSO (UDP_SEGMENT option) is not supported on UDP socket %d: %s!",
+                             socketDescriptor, strerror(errno)) << "\n";
+            LOG_END
+            return false;
+         }
+#else
+         LOG_ERROR
+         stdlog << format("GSO usage on UDP socket %d configured, but not supported by this system!",
+                          socketDescriptor) << "\n";
+         LOG_END
+         return false;
 #endif
       }
    }
@@ -580,5 +792,250 @@ bool Flow::configureSocket(const int socketDescriptor)
 #endif
 #endif
 
+   // ====== Zero-copy transmission =========================================
+   if(TrafficSpec.UseZeroCopy) {
+      configureZeroCopy(socketDescriptor);
+   }
+
+   // ====== Kernel pacing ==================================================
+   if( (TrafficSpec.Pacing == FlowTrafficSpec::KernelPacing) &&
+       (!configureKernelPacing(socketDescriptor)) ) {
+      return false;
+   }
+
+   // ====== Choose protocol-specific transmission functions ================
+   configureTransmission(this);
    return true;
 }
+
+
+// ###### Configure pacing by the kernel ####################################
+// A constant-rate flow gets a socket pacing rate (SO_MAX_PACING_RATE).
+// Otherwise, each UDP frame gets its scheduled time as transmission time
+// (SO_TXTIME). In both cases, frames can be handed to the kernel ahead of
+// time. Without kernel support, the flow falls back to precise pacing.
+bool Flow::configureKernelPacing(const int socketDescriptor)
+{
+   KernelPaced = false;
+   UseTxTime   = false;
+   if(!TrafficSpec.outgoingFlowIsNotSaturated()) {
+      return true;   // Nothing to pace
+   }
+
+   // ====== Constant rate: set socket pacing rate ==========================
+   // NOTE: The passive side's global UDP socket is shared by all UDP flows
+   //       not owning a connected socket, so it must not get the pacing
+   //       rate of a single flow!
+   const bool sharedSocket = ( (TrafficSpec.Protocol == IPPROTO_UDP) &&
+                               (isAcceptedIncomingFlow()) &&
+                               (!DeleteWhenFinished) );
+   if( (TrafficSpec.OutboundFrameRateRng == RANDOM_CONSTANT) &&
+       (TrafficSpec.OutboundFrameSizeRng == RANDOM_CONSTANT) &&
+       (!sharedSocket) ) {
+#if defined(SO_MAX_PACING_RATE)
+      // The rate includes an estimate of the network and transport headers
+      // of each message of a frame.
+      const double messages   = ceil(TrafficSpec.OutboundFrameSize[0] /
+                                     std::min((double)TrafficSpec.MaxMsgSize, 65536.0));
+      const double pacingRate = TrafficSpec.OutboundFrameRate[0] *
+                                   (TrafficSpec.OutboundFrameSize[0] + messages * FLOW_KERNEL_PACING_HEADER_SIZE);
+      const unsigned int rate = (unsigned int)std::min(ceil(pacingRate), (double)(~0U - 1));
+      if(ext_setsockopt(socketDescriptor, SOL_SOCKET, SO_MAX_PACING_RATE, &rate, sizeof(rate)) == 0) {
+         KernelPaced = true;
+         return true;
+      }
+      LOG_WARNING
+      stdlog << format("Failed to configure pacing rate %u B/s (SO_MAX_PACING_RATE option) on socket %d: %s! Using precise pacing instead.",
+                       rate, socketDescriptor, strerror(errno)) << "\n";
+      LOG_END
+      return true;
+#endif
+   }
+
+   // ====== Other processes: set transmission time per frame ===============
+   if(TrafficSpec.Protocol == IPPROTO_UDP) {
+#if defined(SO_TXTIME) && defined(HAVE_SENDMMSG)
+      sock_txtime txTimeConfig;
+      memset(&txTimeConfig, 0, sizeof(txTimeConfig));
+      txTimeConfig.clockid = CLOCK_MONOTONIC;
+      if(ext_setsockopt(socketDescriptor, SOL_SOCKET, SO_TXTIME, &txTimeConfig, sizeof(txTimeConfig)) == 0) {
+         KernelPaced = true;
+         UseTxTime   = true;
+         return true;
+      }
+      LOG_WARNING
+      stdlog << format("Failed to configure transmission time (SO_TXTIME option) on UDP socket %d: %s! Using precise pacing instead.",
+                       socketDescriptor, strerror(errno)) << "\n";
+      LOG_END
+      return true;
+#endif
+   }
+
+   LOG_WARNING
+   stdlog << format("Kernel pacing is not supported for this flow on socket %d. Using precise pacing instead.",
+                    socketDescriptor) << "\n";
+   LOG_END
+   return true;
+}
+
+
+// ###### Configure zero-copy transmission ##################################
+// Only saturated TCP and MPTCP senders use MSG_ZEROCOPY, since their own
+// thread may wait for completions. Without kernel support, the flow sends
+// with copying instead.
+bool Flow::configureZeroCopy(const int socketDescriptor)
+{
+   ZeroCopy = false;
+   if(!TrafficSpec.outgoingFlowIsSaturated()) {
+      return true;   // Only for saturated senders (e.g. the passive side)
+   }
+   if( (TrafficSpec.Protocol != IPPROTO_TCP)
+#if defined(HAVE_MPTCP)
+       && (TrafficSpec.Protocol != IPPROTO_MPTCP)
+#endif
+     ) {
+      LOG_WARNING
+      stdlog << format("Zero-copy transmission is only supported for TCP and MPTCP. Sending with copying on socket %d instead.",
+                       socketDescriptor) << "\n";
+      LOG_END
+      return true;
+   }
+
+#if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+   const int zeroCopyOption = 1;
+   if(ext_setsockopt(socketDescriptor, SOL_SOCKET, SO_ZEROCOPY, &zeroCopyOption, sizeof(zeroCopyOption)) == 0) {
+      if(ZeroCopyHeaders == nullptr) {
+         ZeroCopyHeaders = new NetPerfMeterDataMessage[FLOW_ZEROCOPY_RING_SIZE];
+         ZeroCopyDone    = new bool[FLOW_ZEROCOPY_RING_SIZE];
+      }
+      for(size_t i = 0;i < FLOW_ZEROCOPY_RING_SIZE;i++) {
+         ZeroCopyDone[i] = false;
+      }
+      ZeroCopySent      = 0;
+      ZeroCopyCompleted = 0;
+      ZeroCopyCopied    = false;
+      ZeroCopy          = true;
+      return true;
+   }
+   LOG_WARNING
+   stdlog << format("Failed to configure zero-copy transmission (SO_ZEROCOPY option) on socket %d: %s! Sending with copying instead.",
+                    socketDescriptor, strerror(errno)) << "\n";
+   LOG_END
+#else
+   LOG_WARNING
+   stdlog << format("Zero-copy transmission on socket %d configured, but not supported by this system! Sending with copying instead.",
+                    socketDescriptor) << "\n";
+   LOG_END
+#endif
+   return true;
+}
+
+
+// ###### Get next message header of zero-copy ring #########################
+// A header must not be modified before the kernel has completed the
+// transmission using it. If the ring is full, wait for completions.
+// Returns nullptr, if the flow is stopping.
+NetPerfMeterDataMessage* Flow::getZeroCopyHeader()
+{
+   assure(ZeroCopy);
+   while(!isStopping()) {
+      lock();
+      const bool available = (ZeroCopySent - ZeroCopyCompleted < FLOW_ZEROCOPY_RING_SIZE);
+      unlock();
+      if(available) {
+         return &ZeroCopyHeaders[ZeroCopySent % FLOW_ZEROCOPY_RING_SIZE];
+      }
+
+      // Completions are queued on the socket's error queue (-> POLLERR):
+      pollfd pfd;
+      pfd.fd      = SocketDescriptor;
+      pfd.events  = 0;
+      pfd.revents = 0;
+      ext_poll_wrapper(&pfd, 1, 10);
+      reapZeroCopyCompletions();
+   }
+   return nullptr;
+}
+
+
+// ###### Mark header of zero-copy ring as in flight ########################
+// NOTE: The completion of the transmission may already have been reaped!
+void Flow::commitZeroCopyHeader()
+{
+   lock();
+   ZeroCopySent++;
+   advanceZeroCopyRing();
+   unlock();
+}
+
+
+// ###### Advance zero-copy ring over completed headers #####################
+// NOTE: The Flow has to be locked by the caller!
+void Flow::advanceZeroCopyRing()
+{
+   while( (ZeroCopyCompleted != ZeroCopySent) &&
+          (ZeroCopyDone[ZeroCopyCompleted % FLOW_ZEROCOPY_RING_SIZE]) ) {
+      ZeroCopyDone[ZeroCopyCompleted % FLOW_ZEROCOPY_RING_SIZE] = false;
+      ZeroCopyCompleted++;
+   }
+}
+
+
+// ###### Reap zero-copy completions from the socket's error queue ##########
+// Each completion reports a range of send IDs. The ring advances over all
+// completed headers. Returns true, if completions have been found.
+bool Flow::reapZeroCopyCompletions()
+{
+   bool found = false;
+#if defined(SO_EE_ORIGIN_ZEROCOPY)
+   alignas(struct cmsghdr) char cmsgBuffer[CMSG_SPACE(sizeof(sock_extended_err) + sizeof(sockaddr_in6))];
+   for(;;) {
+      msghdr msg;
+      memset(&msg, 0, sizeof(msg));
+      msg.msg_control    = (char*)&cmsgBuffer;
+      msg.msg_controllen = sizeof(cmsgBuffer);
+      if(ext_recvmsg(SocketDescriptor, &msg, MSG_ERRQUEUE|MSG_DONTWAIT) < 0) {
+         break;
+      }
+      for(cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+         if( ( ((cmsg->cmsg_level == SOL_IP)   && (cmsg->cmsg_type == IP_RECVERR)) ||
+               ((cmsg->cmsg_level == SOL_IPV6) && (cmsg->cmsg_type == IPV6_RECVERR)) ) ) {
+            sock_extended_err error;
+            memcpy(&error, CMSG_DATA(cmsg), sizeof(error));
+            if( (error.ee_origin != SO_EE_ORIGIN_ZEROCOPY) || (error.ee_errno != 0) ) {
+               continue;
+            }
+            found = true;
+
+            lock();
+            // ====== Mark range [ee_info, ee_data] as completed ============
+            // A completion may be reaped before its send has been
+            // committed. Therefore, the whole ring window is accepted.
+            for(uint32_t id = error.ee_info; ; id++) {
+               if(id - ZeroCopyCompleted < FLOW_ZEROCOPY_RING_SIZE) {
+                  ZeroCopyDone[id % FLOW_ZEROCOPY_RING_SIZE] = true;
+               }
+               if(id == error.ee_data) {
+                  break;
+               }
+            }
+            advanceZeroCopyRing();
+            const bool warnCopied = ( (error.ee_code & SO_EE_CODE_ZEROCOPY_COPIED) &&
+                                      (!ZeroCopyCopied) );
+            if(warnCopied) {
+               ZeroCopyCopied = true;
+            }
+            unlock();
+
+            if(warnCopied) {
+               LOG_WARNING
+               stdlog << format("The kernel has copied zero-copy transmissions on socket %d (e.g. for loopback)!",
+                                SocketDescriptor) << "\n";
+               LOG_END
+            }
+         }
+      }
+   }
+#endif
+   return found;
+}
@@ -39,16 +39,47 @@
 #include "messagereader.h"
 #include "outputfile.h"
 #include "thread.h"
+#include "timerwheel.h"
 #include "tools.h"
+#include "traceplayer.h"
 
 #include <map>
 #include <vector>
 
 
+class Flow;
+class SenderThread;
+
+// Protocol-specific functions to send a frame and a message of a frame
+// (chosen per flow by configureTransmission(), see transfer.h)
+typedef void (*FrameTransmitter)(Flow*                    flow,
+                                 const uint32_t           frameID,
+                                 const unsigned long long now,
+                                 const ssize_t            bytesToSend,
+                                 ssize_t&                 bytesSent,
+                                 size_t&                  packetsSent);
+typedef ssize_t (*MessageTransmitter)(Flow*                    flow,
+                                      const uint32_t           frameID,
+                                      const bool               isFrameBegin,
+                                      const bool               isFrameEnd,
+                                      const unsigned long long now,
+                                      size_t                   bytesToSend);
+
+// Busy-waiting time before a frame's scheduled time for SpinPacing (in us)
+#define FLOW_PACING_SPIN_TIME 50
+// Time by which frames are handed to the kernel ahead of schedule for
+// KernelPacing (in us)
+#define FLOW_KERNEL_PACING_LEAD_TIME 2000
+// Estimated network and transport header size per message for KernelPacing
+#define FLOW_KERNEL_PACING_HEADER_SIZE 64
+// Number of message headers in flight for zero-copy transmission
+#define FLOW_ZEROCOPY_RING_SIZE 1024
+
 class Flow : public Thread
 {
    public:
    friend class FlowManager;
+   friend class SenderThread;
    enum FlowStatus {
       WaitingForStartup = 1,
       On                = 2,
@@ -74,6 +105,9 @@ class Flow : public Thread
    inline uint16_t getStreamID() const {
       return StreamID;
    }
+   inline const NetPerfMeterDataMessage& getDataHeaderTemplate() const {
+      return DataHeaderTemplate;
+   }
    inline int getSocketDescriptor() const {
       return SocketDescriptor;
    }
@@ -104,23 +138,23 @@ class Flow : public Thread
       InputStatus = Off;
    }
 
-   inline const FlowBandwidthStats& getCurrentBandwidthStats() const {
-      return CurrentBandwidthStats;
+   inline FlowBandwidthStats getCurrentBandwidthStats() const {
+      return CurrentBandwidthStats.getStats();
    }
-   inline FlowBandwidthStats& getCurrentBandwidthStats() {
-      return CurrentBandwidthStats;
+   inline unsigned long long getTransmittedBytes() const {
+      return CurrentBandwidthStats.TransmittedBytes.load(std::memory_order_relaxed);
    }
    inline unsigned long long getFirstTransmission() const {
-      return FirstTransmission;
+      return FirstTransmission.load(std::memory_order_relaxed);
    }
    inline unsigned long long getLastTransmission() const {
-      return LastTransmission;
+      return LastTransmission.load(std::memory_order_relaxed);
    }
    inline unsigned long long getFirstReception() const {
-      return FirstReception;
+      return FirstReception.load(std::memory_order_relaxed);
    }
    inline unsigned long long getLastReception() const {
-      return LastReception;
+      return LastReception.load(std::memory_order_relaxed);
    }
 
    inline uint32_t nextOutboundFrameID() {
@@ -130,6 +164,51 @@ class Flow : public Thread
       return ++LastOutboundSeqNumber;
    }
 
+   inline FastRandom* getRandomStream() {
+      return &RandomStream;
+   }
+   inline double nextOutboundFrameSize() {
+      if(TrafficSpec.OutboundFrameSizeRng == RANDOM_TRACE) {
+         return OutboundFrameSizeTrace.nextFrameSize();
+      }
+      return getBufferedRandomValue(&OutboundFrameSizeValues,
+                                    (const double*)&TrafficSpec.OutboundFrameSize,
+                                    TrafficSpec.OutboundFrameSizeRng,
+                                    &RandomStream);
+   }
+   inline unsigned long long getTxTime() const {
+      return (UseTxTime) ? TxTime : 0;
+   }
+   inline bool usesZeroCopy() const {
+      return ZeroCopy;
+   }
+   inline bool usesGSO() const {
+      return UseGSO;
+   }
+   inline void disableGSO() {
+      UseGSO = false;
+   }
+   inline size_t getGSOSegmentSize() const {
+      return GSOSegmentSize;
+   }
+   inline void setGSOSegmentSize(const size_t segmentSize) {
+      GSOSegmentSize = segmentSize;
+   }
+   inline FrameTransmitter getFrameTransmitter() const {
+      return TransmitFrame;
+   }
+   inline MessageTransmitter getMessageTransmitter() const {
+      return TransmitMessage;
+   }
+   inline void setTransmitters(FrameTransmitter   frameTransmitter,
+                               MessageTransmitter messageTransmitter) {
+      TransmitFrame   = frameTransmitter;
+      TransmitMessage = messageTransmitter;
+   }
+   NetPerfMeterDataMessage* getZeroCopyHeader();
+   void commitZeroCopyHeader();
+   bool reapZeroCopyCompletions();
+
    inline bool isRemoteAddressValid() const {
       return RemoteAddressIsValid;
    }
@@ -144,16 +223,16 @@ class Flow : public Thread
       return VectorFile;
    }
    inline double getJitter() const {
-      return Jitter;
+      return Jitter.load(std::memory_order_relaxed);
    }
    inline void setJitter(const double jitter) {
-      Jitter = jitter;
+      Jitter.store(jitter, std::memory_order_relaxed);
    }
    inline double getDelay() const {
-      return Delay;
+      return Delay.load(std::memory_order_relaxed);
    }
    inline void setDelay(const double transitTime) {
-      Delay = transitTime;
+      Delay.store(transitTime, std::memory_order_relaxed);
    }
 
    inline Measurement* getMeasurement() const {
@@ -206,49 +285,104 @@ class Flow : public Thread
    unsigned long long scheduleNextTransmissionEvent();
    unsigned long long scheduleNextStatusChangeEvent(const unsigned long long now);
    void handleStatusChangeEvent(const unsigned long long now);
+   unsigned long long scheduleNextEvent();
+   bool handleNextEvent(const unsigned long long now);
+   bool configureKernelPacing(const int socketDescriptor);
+   bool configureZeroCopy(const int socketDescriptor);
+   void advanceZeroCopyRing();
 
 
    // ====== Flow Identification ============================================
    uint64_t           MeasurementID;
    uint32_t           FlowID;
    uint16_t           StreamID;
+   NetPerfMeterDataMessage DataHeaderTemplate;   // Constant fields, network order
 
    // ====== Socket Management ==============================================
    int                SocketDescriptor;
    bool               OriginalSocketDescriptor;
    bool               DeleteWhenFinished;
-   pollfd*            PollFDEntry;   // For internal usage by FlowManager
 
    int                ControlSocketDescriptor;
    sockaddr_union     RemoteAddress;
    bool               RemoteAddressIsValid;
+   int                IndexedSocketDescriptor;   // Keys in FlowManager's
+   bool               IndexedRemoteAddress;      // findFlow() indexes
+   bool               IndexedSocketHandler;
 
 
    // ====== Timing =========================================================
    unsigned long long TimeBase;     // when has flow been started?
    unsigned long long TimeOffset;   // time offset to TimeBase for next event
-   unsigned long long FirstTransmission;
-   unsigned long long FirstReception;
-   unsigned long long LastTransmission;
-   unsigned long long LastReception;
 
    // ====== Traffic Specification ==========================================
    FlowTrafficSpec    TrafficSpec;
-   FlowStatus         InputStatus;
+   std::atomic<FlowStatus> InputStatus;   // Read by ReceiverThread unlocked
    FlowStatus         OutputStatus;
-   uint32_t           LastOutboundFrameID;     // ID of last outbound frame
-   uint64_t           LastOutboundSeqNumber;   // ID of last outbound packet
    unsigned long long NextStatusChangeEvent;
+   bool               KernelPaced;             // Kernel paces -> send ahead
+   bool               UseTxTime;               // Attach SCM_TXTIME to frames
+   bool               ZeroCopy;                // Send with MSG_ZEROCOPY
+   bool               ZeroCopyCopied;          // Kernel has copied anyway
+   bool               UseGSO;                  // Send with UDP GSO
+   size_t             GSOSegmentSize;          // 0 = not determined yet
+   NetPerfMeterDataMessage* ZeroCopyHeaders;   // Ring of headers in flight
+   bool*              ZeroCopyDone;            // Completion flags of ring
+   FrameTransmitter   TransmitFrame;           // Sends a frame
+   MessageTransmitter TransmitMessage;         // Sends a message of a frame
    size_t             OnOffEventPointer;
+   FastRandom         RandomStream;            // Flow's own random stream
+   RandomValueBuffer  OutboundFrameRateValues; // Prefetched frame rates
+   RandomValueBuffer  OutboundFrameSizeValues; // Prefetched frame sizes
+   TracePlayer        OutboundFrameRateTrace;  // Replayed inter-arrival times
+   TracePlayer        OutboundFrameSizeTrace;  // Replayed frame sizes
+   SenderThread*      Sender;                  // Sender thread of the pool, if used
+   TimerWheel::Timer  SenderTimer;             // Schedule entry in sender thread
 
    // ====== Statistics =====================================================
    Measurement*       MyMeasurement;
    OutputFile         VectorFile;
-   FlowBandwidthStats CurrentBandwidthStats;
-   FlowBandwidthStats LastBandwidthStats;
-   double             Delay;    // Transit time of latest received packet
-   double             Jitter;   // Current jitter value
+   FlowBandwidthStats LastBandwidthStats;     // Used by FlowManager only
+
+   // ====== Hot Transmission State =========================================
+   // The state written by the sender for each frame, the state written by
+   // the receiver for each message, and the configuration above are on
+   // separate cache lines. Then, sender and receiver running on different
+   // CPU cores do not invalidate each other's cache lines.
+   // The current statistics are updated without locking. The counters are
+   // read as consistent snapshot per direction (see FlowBandwidthCounters).
+   // Time stamps, delay and jitter are single values, i.e. each of them is
+   // consistent on its own, which is sufficient for the statistics output.
+   alignas(CACHE_LINE_SIZE)
+   std::atomic<unsigned long long> FirstTransmission;
+   std::atomic<unsigned long long> LastTransmission;
+   uint32_t           LastOutboundFrameID;     // ID of last outbound frame
+   uint64_t           LastOutboundSeqNumber;   // ID of last outbound packet
+   unsigned long long NextTransmissionEvent;
+   unsigned long long LastTransmissionEvent;   // Scheduled time of last frame
+   unsigned long long NextTransmissionInterval; // Drawn inter-frame time (~0ULL: none)
+   unsigned long long TxTime;                  // Scheduled time of current frame
+   uint32_t           ZeroCopySent;            // Next zero-copy send ID
+   uint32_t           ZeroCopyCompleted;       // Next send ID to be completed
+   unsigned long long ScheduleErrorFrames;     // Frames sent by schedule
+   unsigned long long ScheduleErrorSum;        // Sum of send time - schedule
+   unsigned long long ScheduleErrorMaximum;    // Maximum of send time - schedule
+
+   // ====== Hot Reception State ============================================
+   alignas(CACHE_LINE_SIZE)
+   std::atomic<unsigned long long> FirstReception;
+   std::atomic<unsigned long long> LastReception;
+   std::atomic<double> Delay;    // Transit time of latest received packet
+   std::atomic<double> Jitter;   // Current jitter value
+
+   // ====== Defragmenter ===================================================
+   // Updated by the receiver for each message.
+   alignas(CACHE_LINE_SIZE)
    Defragmenter       MyDefragmenter;
+
+   // ====== Hot Statistics Counters ========================================
+   // Transmission and reception counters are on separate cache lines.
+   FlowBandwidthCounters CurrentBandwidthStats;
 };
 
 #endif
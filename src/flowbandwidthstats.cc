@@ -165,3 +165,71 @@ void FlowBandwidthStats::reset()
    LostPackets        = 0;
    LostFrames         = 0;
 }
+
+
+// ###### Constructor #######################################################
+FlowBandwidthCounters::FlowBandwidthCounters()
+{
+   reset();
+}
+
+
+// ###### Destructor ########################################################
+FlowBandwidthCounters::~FlowBandwidthCounters()
+{
+}
+
+
+// ###### Reset counters ####################################################
+// NOTE: There must not be a concurrent writer!
+void FlowBandwidthCounters::reset()
+{
+   TransmittedSequence.store(0, std::memory_order_relaxed);
+   TransmittedBytes.store(0, std::memory_order_relaxed);
+   TransmittedPackets.store(0, std::memory_order_relaxed);
+   TransmittedFrames.store(0, std::memory_order_relaxed);
+
+   ReceivedSequence.store(0, std::memory_order_relaxed);
+   ReceivedBytes.store(0, std::memory_order_relaxed);
+   ReceivedPackets.store(0, std::memory_order_relaxed);
+   ReceivedFrames.store(0, std::memory_order_relaxed);
+
+   LostBytes.store(0, std::memory_order_relaxed);
+   LostPackets.store(0, std::memory_order_relaxed);
+   LostFrames.store(0, std::memory_order_relaxed);
+}
+
+
+// ###### Get snapshot of counters ##########################################
+// Each direction is read until its sequence number was even and unchanged,
+// i.e. no update of the direction has been in progress meanwhile.
+FlowBandwidthStats FlowBandwidthCounters::getStats() const
+{
+   FlowBandwidthStats result;
+   unsigned long long sequence;
+
+   // ====== Transmission counters ==========================================
+   do {
+      sequence = TransmittedSequence.load(std::memory_order_acquire);
+      result.TransmittedBytes   = TransmittedBytes.load(std::memory_order_relaxed);
+      result.TransmittedPackets = TransmittedPackets.load(std::memory_order_relaxed);
+      result.TransmittedFrames  = TransmittedFrames.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+   } while( (sequence & 1) ||
+            (sequence != TransmittedSequence.load(std::memory_order_relaxed)) );
+
+   // ====== Reception counters =============================================
+   do {
+      sequence = ReceivedSequence.load(std::memory_order_acquire);
+      result.ReceivedBytes      = ReceivedBytes.load(std::memory_order_relaxed);
+      result.ReceivedPackets    = ReceivedPackets.load(std::memory_order_relaxed);
+      result.ReceivedFrames     = ReceivedFrames.load(std::memory_order_relaxed);
+      result.LostBytes          = LostBytes.load(std::memory_order_relaxed);
+      result.LostPackets        = LostPackets.load(std::memory_order_relaxed);
+      result.LostFrames         = LostFrames.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+   } while( (sequence & 1) ||
+            (sequence != ReceivedSequence.load(std::memory_order_relaxed)) );
+
+   return result;
+}
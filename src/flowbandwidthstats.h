@@ -30,11 +30,19 @@
 #ifndef FLOWBANDWIDTHSTATS_H
 #define FLOWBANDWIDTHSTATS_H
 
+#include <atomic>
 #include <iostream>
 #include <cmath>
 #include <string>
 
 
+// Data written by different threads is placed on separate cache lines, in
+// order to avoid false sharing:
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+
 class FlowBandwidthStats
 {
    // ====== Methods ========================================================
@@ -74,4 +82,89 @@ class FlowBandwidthStats
 FlowBandwidthStats operator+(const FlowBandwidthStats& s1, const FlowBandwidthStats& s2);
 FlowBandwidthStats operator-(const FlowBandwidthStats& s1, const FlowBandwidthStats& s2);
 
+
+// The bandwidth counters of a flow are updated by its sender and receiver
+// without taking the flow's mutex. Each direction has exactly one writer
+// at a time: the sender of the flow for the transmission counters, and the
+// holder of the lock of the flow's ReceiverThread for the reception
+// counters. Each direction is a sequence lock: the writer makes its
+// sequence number odd while updating. getStats() retries reading a
+// direction until it got a consistent snapshot, i.e. bytes, packets and
+// frames always match. The sender's and the receiver's counters are on
+// separate cache lines.
+class FlowBandwidthCounters
+{
+   // ====== Methods ========================================================
+   public:
+   FlowBandwidthCounters();
+   ~FlowBandwidthCounters();
+
+   void reset();
+   FlowBandwidthStats getStats() const;
+
+   inline void addTransmitted(const unsigned long long frames,
+                              const unsigned long long packets,
+                              const unsigned long long bytes) {
+      const unsigned long long sequence = beginWrite(TransmittedSequence);
+      add(TransmittedFrames, frames);
+      add(TransmittedPackets, packets);
+      add(TransmittedBytes, bytes);
+      endWrite(TransmittedSequence, sequence);
+   }
+   inline void addReceived(const unsigned long long frames,
+                           const unsigned long long packets,
+                           const unsigned long long bytes,
+                           const unsigned long long lostFrames,
+                           const unsigned long long lostPackets,
+                           const unsigned long long lostBytes) {
+      const unsigned long long sequence = beginWrite(ReceivedSequence);
+      add(ReceivedFrames, frames);
+      add(ReceivedPackets, packets);
+      add(ReceivedBytes, bytes);
+      add(LostFrames, lostFrames);
+      add(LostPackets, lostPackets);
+      add(LostBytes, lostBytes);
+      endWrite(ReceivedSequence, sequence);
+   }
+
+   // ====== Private Methods ================================================
+   private:
+   // With a single writer, no atomic read-modify-write is necessary:
+   inline static unsigned long long beginWrite(std::atomic<unsigned long long>& sequence) {
+      const unsigned long long value = sequence.load(std::memory_order_relaxed);
+      sequence.store(value + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      return value;
+   }
+   inline static void endWrite(std::atomic<unsigned long long>& sequence,
+                               const unsigned long long         value) {
+      sequence.store(value + 2, std::memory_order_release);
+   }
+   inline static void add(std::atomic<unsigned long long>& counter,
+                          const unsigned long long         value) {
+      counter.store(counter.load(std::memory_order_relaxed) + value,
+                    std::memory_order_relaxed);
+   }
+
+   // ====== Public Data ====================================================
+   public:
+   // ------ Written by the sender ------------------------------------------
+   alignas(CACHE_LINE_SIZE)
+   std::atomic<unsigned long long> TransmittedSequence;
+   std::atomic<unsigned long long> TransmittedBytes;
+   std::atomic<unsigned long long> TransmittedPackets;
+   std::atomic<unsigned long long> TransmittedFrames;
+
+   // ------ Written by the receiver ----------------------------------------
+   alignas(CACHE_LINE_SIZE)
+   std::atomic<unsigned long long> ReceivedSequence;
+   std::atomic<unsigned long long> ReceivedBytes;
+   std::atomic<unsigned long long> ReceivedPackets;
+   std::atomic<unsigned long long> ReceivedFrames;
+
+   std::atomic<unsigned long long> LostBytes;
+   std::atomic<unsigned long long> LostPackets;
+   std::atomic<unsigned long long> LostFrames;
+};
+
 #endif
@@ -37,8 +37,8 @@
 #include <signal.h>
 #include <netinet/tcp.h>
 
+#include <algorithm>
 #include <cstring>
-#include <set>
 #include <sstream>
 
 
@@ -53,10 +53,16 @@ FlowManager FlowManager::FlowManagerSingleton;
 FlowManager::FlowManager()
 {
    DisplayEnabled    = false;
+   ConnectedUDP      = false;
+   UDPSocket         = -1;
+   UseRandomSeed     = false;
+   RandomSeed        = 0;
    DisplayInterval   = 1000000;
    FirstDisplayEvent = 0;
    LastDisplayEvent  = 0;
    NextDisplayEvent  = 0;
+   PollSequenceNumber = 0;
+   configureReceiverThreads(1);
    start();
 }
 
@@ -67,6 +73,18 @@ FlowManager::~FlowManager()
    stop();
    waitForFinish();
 
+   // ====== Stop receiver and sender threads ===============================
+   // NOTE: Their MessageReaders are still needed for the clean-up below!
+   for(std::vector<ReceiverThread*>::iterator iterator = ReceiverThreads.begin();
+       iterator != ReceiverThreads.end(); iterator++) {
+      (*iterator)->stop();
+      (*iterator)->waitForFinish();
+   }
+   for(std::vector<SenderThread*>::iterator iterator = SenderThreads.begin();
+       iterator != SenderThreads.end(); iterator++) {
+      (*iterator)->stop();
+   }
+
    // ====== Clean up measurements ==========================================
    std::map<std::pair<int, uint64_t>, Measurement*>::iterator measurementIterator = MeasurementSet.begin();
    while(measurementIterator != MeasurementSet.end()) {
@@ -80,7 +98,7 @@ FlowManager::~FlowManager()
    while(flowIterator != FlowSet.end()) {
       Flow* flow = *flowIterator;
       if(flow->SocketDescriptor >= 0) {
-         Reader.deregisterSocket(flow->SocketDescriptor);
+         getMessageReader(flow->SocketDescriptor)->deregisterSocket(flow->SocketDescriptor);
          ext_close(flow->SocketDescriptor);
       }
       flowIterator = FlowSet.erase(flowIterator);
@@ -92,10 +110,115 @@ FlowManager::~FlowManager()
    while(udSocketsIterator != UnidentifiedSockets.end()) {
       UnidentifiedSocket* ud = udSocketsIterator->second;
       udSocketsIterator = UnidentifiedSockets.erase(udSocketsIterator);
-      assure(Reader.deregisterSocket(ud->SocketDescriptor) == true);
+      assure(getMessageReader(ud->SocketDescriptor)->deregisterSocket(ud->SocketDescriptor) == true);
       ext_close(ud->SocketDescriptor);
       delete ud;
    }
+   PollSockets.clear();
+
+   // ====== Clean up receiver threads ======================================
+   std::vector<ReceiverThread*>::iterator receiverIterator = ReceiverThreads.begin();
+   while(receiverIterator != ReceiverThreads.end()) {
+      ReceiverThread* receiverThread = *receiverIterator;
+      receiverIterator = ReceiverThreads.erase(receiverIterator);
+      delete receiverThread;
+   }
+
+   // ====== Clean up sender threads ========================================
+   configureSenderThreads(0);
+}
+
+
+// ###### Configure number of receiver threads ##############################
+// The sockets are sharded among the receiver threads by their descriptor.
+// Therefore, the number of threads can only be changed while there are no
+// sockets registered.
+bool FlowManager::configureReceiverThreads(const unsigned int receiverThreads)
+{
+   bool success = (receiverThreads >= 1);
+
+   lock();
+   for(std::vector<ReceiverThread*>::iterator iterator = ReceiverThreads.begin();
+       iterator != ReceiverThreads.end(); iterator++) {
+      if((*iterator)->getMessageReader()->size() > 0) {
+         success = false;
+         break;
+      }
+   }
+   if(success) {
+      while(ReceiverThreads.size() > receiverThreads) {
+         ReceiverThread* receiverThread = ReceiverThreads.back();
+         ReceiverThreads.pop_back();
+         delete receiverThread;
+      }
+      while(ReceiverThreads.size() < receiverThreads) {
+         ReceiverThread* receiverThread = new ReceiverThread((unsigned int)ReceiverThreads.size());
+         assure(receiverThread != nullptr);
+         ReceiverThreads.push_back(receiverThread);
+         receiverThread->start();
+      }
+   }
+   unlock();
+
+   return success;
+}
+
+
+// ###### Configure number of sender threads ################################
+// With sender threads, the non-saturated flows are multiplexed by a pool of
+// threads. Otherwise, each Flow uses its own thread. The number of threads
+// can only be changed while there are no active flows.
+bool FlowManager::configureSenderThreads(const unsigned int senderThreads)
+{
+   bool success = true;
+
+   lock();
+   for(std::vector<SenderThread*>::iterator iterator = SenderThreads.begin();
+       iterator != SenderThreads.end(); iterator++) {
+      if((*iterator)->getFlows() > 0) {
+         success = false;
+         break;
+      }
+   }
+   if(success) {
+      while(SenderThreads.size() > senderThreads) {
+         SenderThread* senderThread = SenderThreads.back();
+         SenderThreads.pop_back();
+         delete senderThread;
+      }
+      while(SenderThreads.size() < senderThreads) {
+         SenderThread* senderThread = new SenderThread((unsigned int)SenderThreads.size());
+         assure(senderThread != nullptr);
+         SenderThreads.push_back(senderThread);
+         senderThread->start();
+      }
+   }
+   unlock();
+
+   return success;
+}
+
+
+// ###### Get sender thread for a new flow ##################################
+// Returns the sender thread with the fewest flows, or nullptr if each Flow
+// has to use its own thread.
+SenderThread* FlowManager::getSenderThread()
+{
+   SenderThread* senderThread = nullptr;
+   size_t        senderFlows  = 0;
+
+   lock();
+   for(std::vector<SenderThread*>::iterator iterator = SenderThreads.begin();
+       iterator != SenderThreads.end(); iterator++) {
+      const size_t flows = (*iterator)->getFlows();
+      if( (senderThread == nullptr) || (flows < senderFlows) ) {
+         senderThread = *iterator;
+         senderFlows  = flows;
+      }
+   }
+   unlock();
+
+   return senderThread;
 }
 
 
@@ -103,8 +226,11 @@ FlowManager::~FlowManager()
 void FlowManager::addFlow(Flow* flow)
 {
    lock();
-   flow->PollFDEntry = nullptr;
    FlowSet.push_back(flow);
+   indexFlow(flow);
+   if(flow->SocketDescriptor >= 0) {
+      updatePollSocket(flow->SocketDescriptor);
+   }
    unlock();
 }
 
@@ -116,7 +242,6 @@ void FlowManager::removeFlow(Flow* flow)
    flow->deactivate();
 
    // ====== Remove flow from flow set ======================================
-   flow->PollFDEntry = nullptr;
    for(std::vector<Flow*>::iterator iterator = FlowSet.begin();
        iterator != FlowSet.end();iterator++) {
        if(*iterator == flow) {
@@ -124,6 +249,9 @@ void FlowManager::removeFlow(Flow* flow)
           break;
       }
    }
+   // The flow may already have been erased from the flow set by the caller,
+   // but it is still in the indexes:
+   unindexFlow(flow);
 
    // ====== Check whether the socket descriptor is still referenced ========
    flow->OriginalSocketDescriptor = true;
@@ -135,6 +263,12 @@ void FlowManager::removeFlow(Flow* flow)
        }
    }
 
+   // ====== Update poll set ================================================
+   // Another flow may take over handling the socket, or it is removed.
+   if(flow->SocketDescriptor >= 0) {
+      updatePollSocket(flow->SocketDescriptor);
+   }
+
    unlock();
 }
 
@@ -159,18 +293,14 @@ Flow* FlowManager::findFlow(const uint64_t measurementID,
                             const uint32_t flowID,
                             const uint16_t streamID)
 {
-   Flow* found = nullptr;
+   Flow*           found = nullptr;
+   const FlowIDKey key   = { measurementID, flowID, streamID };
 
    lock();
-   for(std::vector<Flow*>::iterator iterator = FlowSet.begin();
-       iterator != FlowSet.end();iterator++) {
-      Flow* flow = *iterator;
-      if( (flow->MeasurementID == measurementID) &&
-          (flow->FlowID == flowID) &&
-          (flow->StreamID == streamID) ) {
-         found = flow;
-         break;
-      }
+   std::unordered_map<FlowIDKey, Flow*, FlowIDKeyHash>::const_iterator iterator =
+      FlowIDIndex.find(key);
+   if(iterator != FlowIDIndex.end()) {
+      found = iterator->second;
    }
    unlock();
 
@@ -185,15 +315,10 @@ Flow* FlowManager::findFlow(const int      socketDescriptor,
    Flow* found = nullptr;
 
    lock();
-   for(std::vector<Flow*>::iterator iterator = FlowSet.begin();
-       iterator != FlowSet.end();iterator++) {
-      Flow* flow = *iterator;
-      if(flow->SocketDescriptor == socketDescriptor) {
-         if(flow->StreamID == streamID) {
-            found = flow;
-            break;
-         }
-      }
+   std::unordered_map<uint64_t, Flow*>::const_iterator iterator =
+      FlowSocketIndex.find(getFlowSocketKey(socketDescriptor, streamID));
+   if(iterator != FlowSocketIndex.end()) {
+      found = iterator->second;
    }
    unlock();
 
@@ -204,21 +329,177 @@ Flow* FlowManager::findFlow(const int      socketDescriptor,
 // ###### Find Flow by source address #######################################
 Flow* FlowManager::findFlow(const struct sockaddr* from)
 {
-   Flow* found = nullptr;
+   Flow*          found = nullptr;
+   FlowAddressKey key;
+
+   if(getFlowAddressKey(from, key)) {
+      lock();
+      std::unordered_map<FlowAddressKey, Flow*, FlowAddressKeyHash>::const_iterator iterator =
+         FlowAddressIndex.find(key);
+      if(iterator != FlowAddressIndex.end()) {
+         found = iterator->second;
+      }
+      unlock();
+   }
+
+   return found;
+}
 
+
+// ###### Get findFlow() index key of an address ############################
+// The key matches the comparison of addresscmp(), i.e. an IPv4 address
+// equals its IPv4-mapped IPv6 address.
+bool FlowManager::getFlowAddressKey(const struct sockaddr* address,
+                                    FlowAddressKey&        key)
+{
+   if(address->sa_family == AF_INET6) {
+      memcpy(&key.Address, &((const struct sockaddr_in6*)address)->sin6_addr, 16);
+   }
+   else if(address->sa_family == AF_INET) {
+      key.Address[0] = 0;
+      key.Address[1] = 0;
+      key.Address[2] = htobe32(0xffff);
+      key.Address[3] = ((const struct sockaddr_in*)address)->sin_addr.s_addr;
+   }
+   else {
+      return false;
+   }
+   key.Port = getPort((struct sockaddr*)address);
+   return true;
+}
+
+
+// ###### Add flow to findFlow() indexes ####################################
+void FlowManager::indexFlow(Flow* flow)
+{
+   const FlowIDKey idKey = { flow->MeasurementID, flow->FlowID, flow->StreamID };
+   FlowIDIndex.insert(std::pair<FlowIDKey, Flow*>(idKey, flow));
+
+   flow->IndexedSocketDescriptor = flow->SocketDescriptor;
+   if(flow->IndexedSocketDescriptor >= 0) {
+      FlowSocketIndex.insert(std::pair<uint64_t, Flow*>(
+         getFlowSocketKey(flow->IndexedSocketDescriptor, flow->StreamID), flow));
+      updateReceiverFlow(flow->IndexedSocketDescriptor, flow->StreamID);
+
+      // ====== Candidates for handling the socket in the poll set ==========
+      // The global UDP socket is handled by the main loop. An incoming UDP
+      // association (ControlSocketDescriptor >= 0) uses it, unless it owns
+      // a connected UDP socket.
+      flow->IndexedSocketHandler =
+         !((flow->TrafficSpec.Protocol == IPPROTO_UDP) &&
+           (flow->ControlSocketDescriptor >= 0) &&
+           (!flow->DeleteWhenFinished));
+      if(flow->IndexedSocketHandler) {
+         FlowSocketHandlerIndex[flow->IndexedSocketDescriptor].push_back(flow);
+      }
+   }
+
+   FlowAddressKey addressKey;
+   flow->IndexedRemoteAddress = (flow->RemoteAddressIsValid) &&
+                                (getFlowAddressKey(&flow->RemoteAddress.sa, addressKey));
+   if(flow->IndexedRemoteAddress) {
+      FlowAddressIndex.insert(std::pair<FlowAddressKey, Flow*>(addressKey, flow));
+   }
+}
+
+
+// ###### Remove flow from findFlow() indexes ###############################
+// If another flow shares a key, it takes over the index entry.
+void FlowManager::unindexFlow(Flow* flow)
+{
+   // ====== Identification index ===========================================
+   const FlowIDKey idKey = { flow->MeasurementID, flow->FlowID, flow->StreamID };
+   std::unordered_map<FlowIDKey, Flow*, FlowIDKeyHash>::iterator foundID =
+      FlowIDIndex.find(idKey);
+   if( (foundID != FlowIDIndex.end()) && (foundID->second == flow) ) {
+      FlowIDIndex.erase(foundID);
+   }
+
+   // ====== Socket index ===================================================
+   if(flow->IndexedSocketDescriptor >= 0) {
+      const uint64_t socketKey = getFlowSocketKey(flow->IndexedSocketDescriptor,
+                                                  flow->StreamID);
+      std::unordered_map<uint64_t, Flow*>::iterator foundSocket =
+         FlowSocketIndex.find(socketKey);
+      if( (foundSocket != FlowSocketIndex.end()) && (foundSocket->second == flow) ) {
+         FlowSocketIndex.erase(foundSocket);
+         for(std::vector<Flow*>::iterator iterator = FlowSet.begin();
+             iterator != FlowSet.end();iterator++) {
+            Flow* other = *iterator;
+            if( (other != flow) &&
+                (other->IndexedSocketDescriptor == flow->IndexedSocketDescriptor) &&
+                (other->StreamID == flow->StreamID) ) {
+               FlowSocketIndex.insert(std::pair<uint64_t, Flow*>(socketKey, other));
+               break;
+            }
+         }
+         updateReceiverFlow(flow->IndexedSocketDescriptor, flow->StreamID);
+      }
+      if(flow->IndexedSocketHandler) {
+         std::unordered_map<int, std::vector<Flow*>>::iterator foundHandlers =
+            FlowSocketHandlerIndex.find(flow->IndexedSocketDescriptor);
+         if(foundHandlers != FlowSocketHandlerIndex.end()) {
+            std::vector<Flow*>& handlers = foundHandlers->second;
+            handlers.erase(std::remove(handlers.begin(), handlers.end(), flow),
+                           handlers.end());
+            if(handlers.empty()) {
+               FlowSocketHandlerIndex.erase(foundHandlers);
+            }
+         }
+         flow->IndexedSocketHandler = false;
+      }
+      flow->IndexedSocketDescriptor = -1;
+   }
+
+   // ====== Address index ==================================================
+   FlowAddressKey addressKey;
+   if( (flow->IndexedRemoteAddress) &&
+       (getFlowAddressKey(&flow->RemoteAddress.sa, addressKey)) ) {
+      std::unordered_map<FlowAddressKey, Flow*, FlowAddressKeyHash>::iterator foundAddress =
+         FlowAddressIndex.find(addressKey);
+      if( (foundAddress != FlowAddressIndex.end()) && (foundAddress->second == flow) ) {
+         FlowAddressIndex.erase(foundAddress);
+         for(std::vector<Flow*>::iterator iterator = FlowSet.begin();
+             iterator != FlowSet.end();iterator++) {
+            Flow* other = *iterator;
+            if( (other != flow) && (other->IndexedRemoteAddress) &&
+                (addresscmp(&flow->RemoteAddress.sa, &other->RemoteAddress.sa, true) == 0) ) {
+               FlowAddressIndex.insert(std::pair<FlowAddressKey, Flow*>(addressKey, other));
+               break;
+            }
+         }
+      }
+   }
+   flow->IndexedRemoteAddress = false;
+}
+
+
+// ###### Update flow map of the socket's ReceiverThread ####################
+// The ReceiverThread's flow map mirrors the socket index.
+void FlowManager::updateReceiverFlow(const int      socketDescriptor,
+                                     const uint16_t streamID)
+{
+   std::unordered_map<uint64_t, Flow*>::const_iterator found =
+      FlowSocketIndex.find(getFlowSocketKey(socketDescriptor, streamID));
+   getReceiverThread(socketDescriptor)->setFlow(
+      socketDescriptor, streamID,
+      (found != FlowSocketIndex.end()) ? found->second : nullptr);
+}
+
+
+// ###### Update findFlow() indexes after a flow's keys have changed ########
+void FlowManager::updateFlowIndex(Flow* flow)
+{
    lock();
+   unindexFlow(flow);
    for(std::vector<Flow*>::iterator iterator = FlowSet.begin();
        iterator != FlowSet.end();iterator++) {
-      Flow* flow = *iterator;
-      if( (flow->RemoteAddressIsValid) &&
-          (addresscmp(from, &flow->RemoteAddress.sa, true) == 0) ) {
-         found = flow;
+      if(*iterator == flow) {
+         indexFlow(flow);
          break;
       }
    }
    unlock();
-
-   return found;
 }
 
 
@@ -392,13 +673,14 @@ void FlowManager::addUnidentifiedSocket(const int protocol,
    UnidentifiedSocket* us = new UnidentifiedSocket;
    us->SocketDescriptor = socketDescriptor;
    us->Protocol         = protocol;
-   us->PollFDEntry      = nullptr;
-   us->ToBeRemoved      = false;
-   us->ToBeClosed       = false;
 
    lock();
-   Reader.registerSocket(protocol, socketDescriptor);
+   getMessageReader(socketDescriptor)->registerSocket(protocol, socketDescriptor);
    UnidentifiedSockets.insert(std::pair<int, UnidentifiedSocket*>(socketDescriptor, us));
+   if(protocol == IPPROTO_UDP) {
+      UDPSocket = socketDescriptor;
+   }
+   updatePollSocket(socketDescriptor);
    unlock();
 }
 
@@ -412,12 +694,26 @@ void FlowManager::removeUnidentifiedSocket(const int  socketDescriptor,
       UnidentifiedSockets.find(socketDescriptor);
    if(found != UnidentifiedSockets.end()) {
       UnidentifiedSocket* us = found->second;
-      assure(us->ToBeRemoved == false);
-      // Mark socket for removal. The actual remove cannot be done here,
-      // since this function may be called in the loop iterating over the
-      // UnidentifiedSockets. Removing would invalidate the iterator!
-      us->ToBeRemoved = true;
-      us->ToBeClosed  = closeSocket;
+      UnidentifiedSockets.erase(found);
+      if(socketDescriptor == UDPSocket) {
+         UDPSocket = -1;
+      }
+      // NOTE: Events are dispatched by socket descriptor lookup, i.e. the
+      // removal is also possible while handling an event of this socket.
+      if(closeSocket) {
+         removePollSocket(socketDescriptor);
+      }
+      else {
+         // The socket may now be handled by a Flow:
+         updatePollSocket(socketDescriptor);
+      }
+      const bool deregisteredFromReader =
+         getMessageReader(socketDescriptor)->deregisterSocket(socketDescriptor);
+      if(closeSocket) {
+         assure(deregisteredFromReader);
+         ext_close(socketDescriptor);
+      }
+      delete us;
    }
    unlock();
 }
@@ -437,11 +733,32 @@ Flow* FlowManager::identifySocket(const uint64_t         measurementID,
       isAlreadyInitialised = (flow->getSocketDescriptor() >= 0);
       if(!isAlreadyInitialised) {
          flow->lock();
-         flow->setSocketDescriptor(socketDescriptor, false,
-                                   (flow->getTrafficSpec().Protocol != IPPROTO_UDP));
+         // NOTE: setSocketDescriptor() also updates the findFlow() indexes,
+         //       including the remote address.
          flow->RemoteAddress        = *from;
          flow->RemoteAddressIsValid = (from->sa.sa_family != AF_UNSPEC);
          const int protocol         = flow->getTrafficSpec().Protocol;
+         // An incoming UDP flow shares the global UDP socket, unless it gets
+         // its own connected socket. Then, the kernel demultiplexes the
+         // flows, and their input is handled by the ReceiverThreads.
+         // NOTE: The identification may also arrive on another flow's
+         //       connected socket, which is owned (and closed) by that
+         //       flow. Therefore, always use the global UDP socket here.
+         int sharedSocket    = socketDescriptor;
+         int connectedSocket = -1;
+         if( (protocol == IPPROTO_UDP) && (UDPSocket >= 0) ) {
+            sharedSocket = UDPSocket;
+            if( (ConnectedUDP) && (flow->RemoteAddressIsValid) ) {
+               connectedSocket = createConnectedUDPSocket(UDPSocket, from);
+            }
+         }
+         if(connectedSocket >= 0) {
+            flow->setSocketDescriptor(connectedSocket, false, true);
+         }
+         else {
+            flow->setSocketDescriptor(sharedSocket, false,
+                                      (protocol != IPPROTO_UDP));
+         }
          flow->unlock();
          if(protocol != IPPROTO_UDP) {
             // Socket is now managed in a Flow!
@@ -457,6 +774,54 @@ Flow* FlowManager::identifySocket(const uint64_t         measurementID,
 }
 
 
+// ###### Create connected UDP socket for an incoming flow ##################
+// The socket is bound to the local address and port of the global UDP
+// socket, with SO_REUSEPORT, and connected to the flow's remote address.
+int FlowManager::createConnectedUDPSocket(const int             udpSocket,
+                                          const sockaddr_union* remoteAddress)
+{
+#if defined(SO_REUSEPORT)
+   sockaddr_union localAddress;
+   socklen_t      localAddressLength = sizeof(localAddress);
+   if(ext_getsockname(udpSocket, &localAddress.sa, &localAddressLength) < 0) {
+      return -1;
+   }
+   const int sd = ext_socket(localAddress.sa.sa_family, SOCK_DGRAM, IPPROTO_UDP);
+   if(sd < 0) {
+      return -1;
+   }
+
+   const int on     = 1;
+   int       v6only = 0;
+#if defined(IPV6_V6ONLY)
+   socklen_t v6onlyLength = sizeof(v6only);
+   if( (localAddress.sa.sa_family == AF_INET6) &&
+       (ext_getsockopt(udpSocket, IPPROTO_IPV6, IPV6_V6ONLY, &v6only, &v6onlyLength) < 0) ) {
+      v6only = 0;
+   }
+#endif
+   if( (ext_setsockopt(sd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) < 0) ||
+       (ext_setsockopt(sd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) < 0) ||
+#if defined(IPV6_V6ONLY)
+       ( (localAddress.sa.sa_family == AF_INET6) &&
+         (ext_setsockopt(sd, IPPROTO_IPV6, IPV6_V6ONLY, &v6only, sizeof(v6only)) < 0) ) ||
+#endif
+       (ext_bind(sd, &localAddress.sa, localAddressLength) < 0) ||
+       (ext_connect(sd, &remoteAddress->sa, getSocklen(&remoteAddress->sa)) < 0) ) {
+      LOG_WARNING
+      stdlog << format("Failed to create connected UDP socket, using shared UDP socket %d instead: %s!",
+                       udpSocket, strerror(errno)) << "\n";
+      LOG_END
+      ext_close(sd);
+      return -1;
+   }
+   return sd;
+#else
+   return -1;
+#endif
+}
+
+
 // ###### Get next statistics or display events #############################
 unsigned long long FlowManager::getNextEvent()
 {
@@ -589,8 +954,13 @@ void FlowManager::writeScalarStatistics(const uint64_t           measurementID,
       Flow* flow = *iterator;
       flow->lock();
       if(flow->MeasurementID == measurementID) {
-         const double transmissionDuration = (flow->LastTransmission - flow->FirstTransmission) / 1000000.0;
-         const double receptionDuration    = (flow->LastReception - flow->FirstReception) / 1000000.0;
+         const FlowBandwidthStats stats             = flow->getCurrentBandwidthStats();
+         const unsigned long long firstTransmission = flow->getFirstTransmission();
+         const unsigned long long lastTransmission  = flow->getLastTransmission();
+         const unsigned long long firstReception    = flow->getFirstReception();
+         const unsigned long long lastReception     = flow->getLastReception();
+         const double transmissionDuration = (lastTransmission - firstTransmission) / 1000000.0;
+         const double receptionDuration    = (lastReception - firstReception) / 1000000.0;
          scalarFile.printf(
             "scalar \"%s.flow[%u]\" \"First Transmission\"      %llu\n"
             "scalar \"%s.flow[%u]\" \"Last Transmission\"       %llu\n"
@@ -611,28 +981,35 @@ void FlowManager::writeScalarStatistics(const uint64_t           measurementID,
             "scalar \"%s.flow[%u]\" \"Received Packet Rate\"    %1.6f\n"
             "scalar \"%s.flow[%u]\" \"Received Frame Rate\"     %1.6f\n"
             ,
-            objectName.c_str(), flow->FlowID, flow->FirstTransmission,
-            objectName.c_str(), flow->FlowID, flow->LastTransmission,
-            objectName.c_str(), flow->FlowID, flow->FirstReception,
-            objectName.c_str(), flow->FlowID, flow->LastReception,
-
-            objectName.c_str(), flow->FlowID, flow->CurrentBandwidthStats.TransmittedBytes,
-            objectName.c_str(), flow->FlowID, flow->CurrentBandwidthStats.TransmittedPackets,
-            objectName.c_str(), flow->FlowID, flow->CurrentBandwidthStats.TransmittedFrames,
-            objectName.c_str(), flow->FlowID, (transmissionDuration > 0.0) ? 8ULL * flow->CurrentBandwidthStats.TransmittedBytes / transmissionDuration : 0.0,
-            objectName.c_str(), flow->FlowID, (transmissionDuration > 0.0) ? flow->CurrentBandwidthStats.TransmittedBytes   / transmissionDuration : 0.0,
-            objectName.c_str(), flow->FlowID, (transmissionDuration > 0.0) ? flow->CurrentBandwidthStats.TransmittedPackets / transmissionDuration : 0.0,
-            objectName.c_str(), flow->FlowID, (transmissionDuration > 0.0) ? flow->CurrentBandwidthStats.TransmittedFrames  / transmissionDuration : 0.0,
-
-            objectName.c_str(), flow->FlowID, flow->CurrentBandwidthStats.ReceivedBytes,
-            objectName.c_str(), flow->FlowID, flow->CurrentBandwidthStats.ReceivedPackets,
-            objectName.c_str(), flow->FlowID, flow->CurrentBandwidthStats.ReceivedFrames,
-            objectName.c_str(), flow->FlowID, (receptionDuration > 0.0) ? 8ULL * flow->CurrentBandwidthStats.ReceivedBytes / receptionDuration : 0.0,
-            objectName.c_str(), flow->FlowID, (receptionDuration > 0.0) ? flow->CurrentBandwidthStats.ReceivedBytes   / receptionDuration : 0.0,
-            objectName.c_str(), flow->FlowID, (receptionDuration > 0.0) ? flow->CurrentBandwidthStats.ReceivedPackets / receptionDuration : 0.0,
-            objectName.c_str(), flow->FlowID, (receptionDuration > 0.0) ? flow->CurrentBandwidthStats.ReceivedFrames  / receptionDuration : 0.0
+            objectName.c_str(), flow->FlowID, firstTransmission,
+            objectName.c_str(), flow->FlowID, lastTransmission,
+            objectName.c_str(), flow->FlowID, firstReception,
+            objectName.c_str(), flow->FlowID, lastReception,
+
+            objectName.c_str(), flow->FlowID, stats.TransmittedBytes,
+            objectName.c_str(), flow->FlowID, stats.TransmittedPackets,
+            objectName.c_str(), flow->FlowID, stats.TransmittedFrames,
+            objectName.c_str(), flow->FlowID, (transmissionDuration > 0.0) ? 8ULL * stats.TransmittedBytes / transmissionDuration : 0.0,
+            objectName.c_str(), flow->FlowID, (transmissionDuration > 0.0) ? stats.TransmittedBytes   / transmissionDuration : 0.0,
+            objectName.c_str(), flow->FlowID, (transmissionDuration > 0.0) ? stats.TransmittedPackets / transmissionDuration : 0.0,
+            objectName.c_str(), flow->FlowID, (transmissionDuration > 0.0) ? stats.TransmittedFrames  / transmissionDuration : 0.0,
+
+            objectName.c_str(), flow->FlowID, stats.ReceivedBytes,
+            objectName.c_str(), flow->FlowID, stats.ReceivedPackets,
+            objectName.c_str(), flow->FlowID, stats.ReceivedFrames,
+            objectName.c_str(), flow->FlowID, (receptionDuration > 0.0) ? 8ULL * stats.ReceivedBytes / receptionDuration : 0.0,
+            objectName.c_str(), flow->FlowID, (receptionDuration > 0.0) ? stats.ReceivedBytes   / receptionDuration : 0.0,
+            objectName.c_str(), flow->FlowID, (receptionDuration > 0.0) ? stats.ReceivedPackets / receptionDuration : 0.0,
+            objectName.c_str(), flow->FlowID, (receptionDuration > 0.0) ? stats.ReceivedFrames  / receptionDuration : 0.0
             );
-         totalBandwidthStats = totalBandwidthStats + flow->CurrentBandwidthStats;
+         if(flow->ScheduleErrorFrames > 0) {
+            scalarFile.printf(
+               "scalar \"%s.flow[%u]\" \"Average Schedule Error\"  %1.6f\n"
+               "scalar \"%s.flow[%u]\" \"Maximum Schedule Error\"  %llu\n",
+               objectName.c_str(), flow->FlowID, (double)flow->ScheduleErrorSum / (double)flow->ScheduleErrorFrames,
+               objectName.c_str(), flow->FlowID, flow->ScheduleErrorMaximum);
+         }
+         totalBandwidthStats = totalBandwidthStats + stats;
       }
       flow->unlock();
    }
@@ -702,6 +1079,24 @@ void FlowManager::writeScalarStatistics(const uint64_t           measurementID,
                         CPULoadStats.getCpuStateName(j),
                         CPULoadStats.getCpuStatePercentage(0, j));
    }
+
+   // ====== Write sender thread statistics =================================
+   lock();
+   for(std::vector<SenderThread*>::iterator iterator = SenderThreads.begin();
+       iterator != SenderThreads.end(); iterator++) {
+      unsigned long long events;
+      double             averageLateness;
+      unsigned long long maximumLateness;
+      (*iterator)->getLatenessStatistics(events, averageLateness, maximumLateness);
+      scalarFile.printf(
+         "scalar \"%s.sender[%u]\" \"Scheduled Events\"        %llu\n"
+         "scalar \"%s.sender[%u]\" \"Average Lateness\"        %1.3f\n"
+         "scalar \"%s.sender[%u]\" \"Maximum Lateness\"        %llu\n",
+         objectName.c_str(), (*iterator)->getID(), events,
+         objectName.c_str(), (*iterator)->getID(), averageLateness,
+         objectName.c_str(), (*iterator)->getID(), maximumLateness);
+   }
+   unlock();
 }
 
 
@@ -733,11 +1128,14 @@ void FlowManager::writeVectorStatistics(const uint64_t           measurementID,
        iterator != FlowSet.end();iterator++) {
        Flow* flow = *iterator;
        if(flow->MeasurementID == measurementID) {
-          flow->lock();
+          // The flow's statistics are read without taking its mutex. Then,
+          // its sender and receiver are not blocked.
+          const FlowBandwidthStats currentStats = flow->getCurrentBandwidthStats();
+          const double             jitter       = flow->getJitter();
 
-          const FlowBandwidthStats relStats = flow->CurrentBandwidthStats - flow->LastBandwidthStats;
+          const FlowBandwidthStats relStats = currentStats - flow->LastBandwidthStats;
           lastTotalStats     = lastTotalStats + flow->LastBandwidthStats;
-          currentTotalStats  = currentTotalStats + flow->CurrentBandwidthStats;
+          currentTotalStats  = currentTotalStats + currentStats;
           CurrentGlobalStats = CurrentGlobalStats + relStats;
 
           const unsigned long long line = vectorFile.getLine();
@@ -750,24 +1148,23 @@ void FlowManager::writeVectorStatistics(const uint64_t           measurementID,
                "\"Lost\"\t%llu\t%llu\t%llu\t%llu\t%llu\t%llu\n",
 
             line + 1, now, (double)(now - firstStatisticsEvent) / 1000000.0, duration,
-               flow->FlowID, flow->TrafficSpec.Description.c_str(), flow->Jitter,
-               flow->CurrentBandwidthStats.TransmittedBytes, flow->CurrentBandwidthStats.TransmittedPackets, flow->CurrentBandwidthStats.TransmittedFrames,
+               flow->FlowID, flow->TrafficSpec.Description.c_str(), jitter,
+               currentStats.TransmittedBytes, currentStats.TransmittedPackets, currentStats.TransmittedFrames,
                relStats.TransmittedBytes, relStats.TransmittedPackets, relStats.TransmittedFrames,
 
             line + 2, now, (double)(now - firstStatisticsEvent) / 1000000.0, duration,
-               flow->FlowID, flow->TrafficSpec.Description.c_str(), flow->Jitter,
-               flow->CurrentBandwidthStats.ReceivedBytes, flow->CurrentBandwidthStats.ReceivedPackets, flow->CurrentBandwidthStats.ReceivedFrames,
+               flow->FlowID, flow->TrafficSpec.Description.c_str(), jitter,
+               currentStats.ReceivedBytes, currentStats.ReceivedPackets, currentStats.ReceivedFrames,
                relStats.ReceivedBytes, relStats.ReceivedPackets, relStats.ReceivedFrames,
 
             line + 3, now, (double)(now - firstStatisticsEvent) / 1000000.0, duration,
-               flow->FlowID, flow->TrafficSpec.Description.c_str(), flow->Jitter,
-               flow->CurrentBandwidthStats.LostBytes, flow->CurrentBandwidthStats.LostPackets, flow->CurrentBandwidthStats.LostFrames,
+               flow->FlowID, flow->TrafficSpec.Description.c_str(), jitter,
+               currentStats.LostBytes, currentStats.LostPackets, currentStats.LostFrames,
                relStats.LostBytes, relStats.LostPackets, relStats.LostFrames);
 
           vectorFile.nextLine(); vectorFile.nextLine(); vectorFile.nextLine();
 
-          flow->LastBandwidthStats = flow->CurrentBandwidthStats;
-          flow->unlock();
+          flow->LastBandwidthStats = currentStats;
        }
    }
 
@@ -806,196 +1203,296 @@ void FlowManager::writeVectorStatistics(const uint64_t           measurementID,
 }
 
 
-// ###### Reception thread function #########################################
-void FlowManager::run()
+// ###### Update socket in poll set ########################################
+// The socket is handled by the first Flow expecting input on it. Otherwise,
+// it may still be a yet unidentified socket. If neither applies, it is
+// removed from the poll set.
+void FlowManager::updatePollSocket(const int socketDescriptor)
 {
-   signal(SIGPIPE, SIG_IGN);
-
-   do {
-      // ====== Collect PollFDs for poll() ==================================
-      lock();
-
-      // NOTE:
-      // The UDP socket handles flows and incoming new connects.
-      // It is handled by mainLoop() of netperfmeter.cc, i.e. it must to be
-      // ignored here!
+   lock();
 
-      // ------ Get socket descriptors for flows ----------------------------
-      std::set<int> socketSet;
-      pollfd        pollFDs[FlowSet.size() + UnidentifiedSockets.size()];
-      unsigned int  n = 0;
-#if defined(DEBUG_POLL)
-      std::cerr << "poll-init:\n";
-#endif
-      for(unsigned int i = 0;i  < FlowSet.size(); i++) {
-         FlowSet[i]->lock();
-         FlowSet[i]->PollFDEntry = nullptr;
-         if( (FlowSet[i]->InputStatus != Flow::Off) &&
-             (FlowSet[i]->SocketDescriptor >= 0) ) {
-            if(!((FlowSet[i]->getTrafficSpec().Protocol == IPPROTO_UDP) &&   // Global UDP socket is handled by main loop!
-                 (FlowSet[i]->ControlSocketDescriptor >= 0)) ) {             // Incoming UDP association has ControlSocketDescriptor >= 0.
-               if(socketSet.find(FlowSet[i]->SocketDescriptor) == socketSet.end()) {
-                  pollFDs[n].fd      = FlowSet[i]->SocketDescriptor;
-                  pollFDs[n].events  = POLLIN;
-                  pollFDs[n].revents = 0;
-                  FlowSet[i]->PollFDEntry = &pollFDs[n];
-                  n++;
-                  socketSet.insert(FlowSet[i]->SocketDescriptor);
-#if defined(DEBUG_POLL)
-                  std::cerr << "\t" << n << ": flow socket " << FlowSet[i]->SocketDescriptor
-                            << " protocol " << FlowSet[i]->getTrafficSpec().Protocol << "\n";
-#endif
-               }
-            }
+   // ====== Find handler for the socket ====================================
+   // Only the flows of this socket are checked, not the whole flow set.
+   Flow* flowHandler = nullptr;
+   std::unordered_map<int, std::vector<Flow*>>::const_iterator handlers =
+      FlowSocketHandlerIndex.find(socketDescriptor);
+   if(handlers != FlowSocketHandlerIndex.end()) {
+      for(std::vector<Flow*>::const_iterator iterator = handlers->second.begin();
+          iterator != handlers->second.end(); iterator++) {
+         Flow* flow = *iterator;
+         flow->lock();
+         if(flow->InputStatus != Flow::Off) {
+            flowHandler = flow;
          }
-         FlowSet[i]->unlock();
+         flow->unlock();
+         if(flowHandler != nullptr) {
+            break;
+         }
+      }
+   }
+   UnidentifiedSocket* unidentifiedHandler = nullptr;
+   if(flowHandler == nullptr) {
+      std::map<int, UnidentifiedSocket*>::iterator found =
+         UnidentifiedSockets.find(socketDescriptor);
+      // NOTE: The UDP socket is handled by mainLoop() of netperfmeter.cc!
+      if( (found != UnidentifiedSockets.end()) &&
+          (found->second->Protocol != IPPROTO_UDP) ) {
+         unidentifiedHandler = found->second;
       }
+   }
 
-      // ------ Get socket descriptors for yet unidentified associations ----
-      for(std::map<int, UnidentifiedSocket*>::iterator iterator = UnidentifiedSockets.begin();
-          iterator != UnidentifiedSockets.end(); iterator++) {
-         UnidentifiedSocket* ud = iterator->second;
-         ud->PollFDEntry = nullptr;
-         // See note above about UDP: UDP is handled by mainLoop()!
-         if(ud->Protocol != IPPROTO_UDP) {
-            pollFDs[n].fd      = ud->SocketDescriptor;
-            pollFDs[n].events  = POLLIN;
-            pollFDs[n].revents = 0;
-            ud->PollFDEntry = &pollFDs[n];
+   // ====== Update poll set ================================================
+   if( (flowHandler == nullptr) && (unidentifiedHandler == nullptr) ) {
+      removePollSocket(socketDescriptor);
+   }
+   else {
+      std::map<int, PollSocket>::iterator found = PollSockets.find(socketDescriptor);
+      if(found == PollSockets.end()) {
+         PollSocket pollSocket;
+         pollSocket.FlowHandler         = flowHandler;
+         pollSocket.UnidentifiedHandler = unidentifiedHandler;
+         pollSocket.SequenceNumber      = ++PollSequenceNumber;
+         PollSockets.insert(std::pair<int, PollSocket>(socketDescriptor, pollSocket));
+         getReceiverThread(socketDescriptor)->addSocket(
+            socketDescriptor, pollSocket.SequenceNumber,
+            (flowHandler != nullptr) ? flowHandler->getTrafficSpec().Protocol :
+                                       unidentifiedHandler->Protocol);
 #if defined(DEBUG_POLL)
-            std::cerr << "\t" << n << ": unidentified socket "
-                      << ud->SocketDescriptor
-                      << " protocol " << ud->Protocol << "\n";
+         std::cerr << "poll-add: socket " << socketDescriptor
+                   << ((flowHandler != nullptr) ? " (flow)" : " (unidentified)") << "\n";
 #endif
-            n++;
-         }
       }
-      const unsigned long long nextEvent = getNextEvent();
-      unlock();
+      else {
+         found->second.FlowHandler         = flowHandler;
+         found->second.UnidentifiedHandler = unidentifiedHandler;
+      }
+   }
 
+   unlock();
+}
 
-      // ====== Wait for events =============================================
-      unsigned long long now = getMicroTime();
-      const int timeout = pollTimeout(getMicroTime(), 2,
-                                      now + 2500000,
-                                      nextEvent);
-#if defined(DEBUG_POLL)
-      std::cerr << "poll with timeout=" << timeout << " ms\n";
-#endif
-      const int result = ext_poll_wrapper((pollfd*)&pollFDs, n, timeout);
+
+// ###### Remove socket from poll set #######################################
+void FlowManager::removePollSocket(const int socketDescriptor)
+{
+   lock();
+   std::map<int, PollSocket>::iterator found = PollSockets.find(socketDescriptor);
+   if(found != PollSockets.end()) {
+      getReceiverThread(socketDescriptor)->removeSocket(socketDescriptor);
+      PollSockets.erase(found);
 #if defined(DEBUG_POLL)
-      std::cerr << "poll result=" << result << "\n";
+      std::cerr << "poll-remove: socket " << socketDescriptor << "\n";
 #endif
+   }
+   unlock();
+}
+
+
+// ###### Handle error-only event of socket #################################
+// Pending completions of zero-copy transmissions signal an error event
+// without readable data. They are reaped here, since reading from the
+// (blocking) socket would wait for data. Returns true, if the event has
+// been handled; otherwise, it has to be handled as read event.
+bool FlowManager::handleSocketErrorEvent(const int      socketDescriptor,
+                                         const uint32_t sequenceNumber)
+{
+   bool handled = false;
+
+   lock();
+   std::map<int, PollSocket>::iterator found = PollSockets.find(socketDescriptor);
+   if( (found != PollSockets.end()) &&
+       (found->second.SequenceNumber == sequenceNumber) &&
+       (found->second.FlowHandler != nullptr) &&
+       (found->second.FlowHandler->usesZeroCopy()) ) {
+      found->second.FlowHandler->reapZeroCopyCompletions();
+      handled = true;
+   }
+   unlock();
 
+   return handled;
+}
+
+
+// ###### Handle read event of socket #######################################
+// This function is called by the ReceiverThread of the socket. The message
+// is read without locking the FlowManager. NETPERFMETER_DATA messages of
+// known flows are handled by the ReceiverThread's own flow map, without
+// locking the FlowManager or the flow. Only other messages (identification,
+// end of input, unknown flows) take the FlowManager's lock.
+void FlowManager::handleSocketEvent(ReceiverThread*          receiverThread,
+                                    const unsigned long long now,
+                                    const int                socketDescriptor,
+                                    const uint32_t           sequenceNumber)
+{
+   MessageReader*  messageReader = receiverThread->getMessageReader();
+   char            inputBuffer[65536];
+   sockaddr_union  from;
+   socklen_t       fromlen;
+   int             flags;
+   int64_t         streamID;
+   int             socketProtocol;
+   bool            dataOkay;
+
+   do {
+      // ====== Read message (or fragment) ==================================
+      // NOTE: The ReceiverThread is locked while reading, i.e. the socket
+      //       cannot be removed and closed in the meantime.
+      fromlen  = sizeof(from);
+      flags    = 0;
+      streamID = 0;
+      receiverThread->lock();
+      if(!receiverThread->hasSocket(socketDescriptor, sequenceNumber, &socketProtocol)) {
+         receiverThread->unlock();
+         return;   // The socket has been removed or replaced in the meantime.
+      }
+      const ssize_t received =
+         messageReader->receiveMessage(socketDescriptor,
+                                       &inputBuffer, sizeof(inputBuffer),
+                                       &from.sa, &fromlen, &streamID, &flags);
+      if(received == MRRM_PARTIAL_READ) {
+         receiverThread->unlock();
+         return;   // Partial read -> wait for next fragment.
+      }
+
+      // ====== Handle data message by the ReceiverThread's flow map =======
+      dataOkay = handleNetPerfMeterDataByReceiver(receiverThread, now, socketProtocol,
+                                                  socketDescriptor,
+                                                  (const char*)&inputBuffer, received,
+                                                  &from, streamID, flags);
+      if(dataOkay) {
+         receiverThread->unlock();
+         continue;
+      }
+      receiverThread->unlock();
 
-      // ====== Handle events ===============================================
       lock();
 
-      now = getMicroTime();
-      if(result > 0) {
-         // ====== Handle read events of flows ==============================
-         for(unsigned int i = 0; i < FlowSet.size(); i++) {
-            FlowSet[i]->lock();
-            const pollfd* entry = FlowSet[i]->PollFDEntry;
-            if(entry) {
-
-               // ====== Handle data message ================================
-               if(entry->revents & (POLLIN|POLLERR)) {
-                  const int protocol = FlowSet[i]->getTrafficSpec().Protocol;
+      // ====== Find handler ================================================
+      std::map<int, PollSocket>::iterator found = PollSockets.find(socketDescriptor);
+      Flow* flow = nullptr;
+      while( (found != PollSockets.end()) &&
+             (found->second.SequenceNumber == sequenceNumber) &&
+             (found->second.FlowHandler != nullptr) ) {
+         flow = found->second.FlowHandler;
+         flow->lock();
+         if(flow->InputStatus != Flow::Off) {
+            break;
+         }
+         // The flow does not expect input any more -> find another handler.
+         flow->unlock();
+         flow = nullptr;
+         updatePollSocket(socketDescriptor);
+         found = PollSockets.find(socketDescriptor);
+      }
+      if( (found == PollSockets.end()) ||
+          (found->second.SequenceNumber != sequenceNumber) ) {
+         unlock();
+         return;   // The socket has been removed or replaced in the meantime.
+      }
+
+      // ====== Handle data message of flow =================================
+      if(flow != nullptr) {
+         const int protocol = flow->getTrafficSpec().Protocol;
 #if defined(DEBUG_POLL)
-                  std::cerr << "\tPOLLIN: flow " << FlowSet[i]->SocketDescriptor
-                            << " protocol " << FlowSet[i]->getTrafficSpec().Protocol << "\n";
+         std::cerr << "\tPOLLIN: flow " << socketDescriptor
+                   << " protocol " << protocol << "\n";
 #endif
-                  // NOTE: FlowSet[i] may not be the actual Flow!
-                  //       It may be another stream of the same SCTP assoc!
-                  const bool dataOkay = handleNetPerfMeterData(true, now,
-                                                               protocol, entry->fd);
-                  if(!dataOkay) {
-                     // Close the broken connection!
-                     LOG_WARNING
-                     stdlog << format("Closing disconnected socket %d!",
-                                       FlowSet[i]->SocketDescriptor) << "\n";
-                     LOG_END
-                     const bool deregisteredFromReader =
-                        Reader.deregisterSocket(FlowSet[i]->SocketDescriptor);
-                     if( (protocol != IPPROTO_SCTP)
+         // NOTE: flow may not be the actual Flow!
+         //       It may be another stream of the same SCTP assoc!
+         //       A connected UDP socket may also have received datagrams
+         //       of other flows before connect(). Therefore, incoming UDP
+         //       flows are always identified by their source address.
+         const bool byAddress = (protocol == IPPROTO_UDP) &&
+                                (flow->isAcceptedIncomingFlow());
+         dataOkay = handleNetPerfMeterMessage(!byAddress, now, protocol, socketDescriptor,
+                                              (const char*)&inputBuffer, received,
+                                              &from, streamID, flags);
+         if(!dataOkay) {
+            // Close the broken connection!
+            LOG_WARNING
+            stdlog << format("Closing disconnected socket %d!",
+                             socketDescriptor) << "\n";
+            LOG_END
+            const bool deregisteredFromReader =
+               messageReader->deregisterSocket(socketDescriptor);
+            if( (protocol != IPPROTO_SCTP)
 #if defined(HAVE_QUIC)
-                         && (protocol != IPPROTO_QUIC)
+                && (protocol != IPPROTO_QUIC)
 #endif
-                       ) {
-                        // Only SCTP and QUIC have streams. For other protocols
-                        // there is just one flow using this socket. Then, it
-                        // cannot be referenced any more.
-                        assure(deregisteredFromReader);
-                     }
-                     if(deregisteredFromReader) {
-                        ext_close(FlowSet[i]->SocketDescriptor);
-                        FlowSet[i]->SocketDescriptor = -1;
-                     }
-                  }
-               }
+              ) {
+               // Only SCTP and QUIC have streams. For other protocols
+               // there is just one flow using this socket. Then, it
+               // cannot be referenced any more.
+               assure(deregisteredFromReader);
+            }
+            if(deregisteredFromReader) {
+               removePollSocket(socketDescriptor);
+               ext_close(socketDescriptor);
+               flow->SocketDescriptor = -1;
+               updateFlowIndex(flow);
             }
-            FlowSet[i]->unlock();
          }
+         flow->unlock();
+      }
 
-         // ====== Handle read events of yet unidentified sockets ===========
-         // Iterate in while loop, for removals and necessary iterator updates!
-         std::map<int, UnidentifiedSocket*>::iterator iterator = UnidentifiedSockets.begin();
-         while(iterator != UnidentifiedSockets.end()) {
-            UnidentifiedSocket* ud = iterator->second;
-            // See note above about UDP: UDP is handled by mainLoop()!
-            if(ud->Protocol != IPPROTO_UDP) {
-               const pollfd* entry = ud->PollFDEntry;
-               if(entry) {
-
-                  // ====== Handle data message =============================
-                  if( (ud->ToBeRemoved == false) &&
-                      (entry->revents & (POLLIN|POLLERR)) ) {
+      // ====== Handle data message of yet unidentified socket ==============
+      else {
+         const int protocol = found->second.UnidentifiedHandler->Protocol;
 #if defined(DEBUG_POLL)
-                     std::cerr << "\tPOLLIN: unidentified " << ud->SocketDescriptor
-                                 << " protocol " << ud->Protocol << "\n";
+         std::cerr << "\tPOLLIN: unidentified " << socketDescriptor
+                   << " protocol " << protocol << "\n";
 #endif
-                     const bool dataOkay = handleNetPerfMeterData(true, now,
-                                                                  ud->Protocol,
-                                                                  ud->SocketDescriptor);
-                     if(!dataOkay) {
-                        // Incoming connection has already been closed -> remove it!
-                        LOG_WARNING
-                        stdlog << format("Shutdown of still unidentified incoming connection on socket %d!",
-                                         ud->SocketDescriptor) << "\n";
-                        LOG_END
-                        ud->ToBeRemoved = true;   // Mark for removal
-                        ud->ToBeClosed  = true;
-                     }
-                  }
-
-                  // ====== Check removal from UnidentifiedSockets ==========
-                  if(ud->ToBeRemoved == true) {
-                     // Remove the socket marked by removeUnidentifiedSocket(),
-                     // or by ud->ToBeRemoved = true above:
-                     // However, since we are in an interation loop, we
-                     // must ensure that the iterator remains valid!
-                     iterator = UnidentifiedSockets.erase(iterator);
-                     const bool deregisteredFromReader =
-                        Reader.deregisterSocket(ud->SocketDescriptor);
-                     if(ud->ToBeClosed) {
-                        assure(deregisteredFromReader);
-                        ext_close(ud->SocketDescriptor);
-                     }
-                     delete ud;
-                     continue;   // Next iteration, the iterator is already correct!
-                  }
-               }
+         dataOkay = handleNetPerfMeterMessage(true, now, protocol, socketDescriptor,
+                                              (const char*)&inputBuffer, received,
+                                              &from, streamID, flags);
+         if(!dataOkay) {
+            // Incoming connection has already been closed -> remove it!
+            // NOTE: If the socket has been identified meanwhile, it is
+            //       not an unidentified socket any more.
+            if(UnidentifiedSockets.find(socketDescriptor) != UnidentifiedSockets.end()) {
+               LOG_WARNING
+               stdlog << format("Shutdown of still unidentified incoming connection on socket %d!",
+                                socketDescriptor) << "\n";
+               LOG_END
+               removeUnidentifiedSocket(socketDescriptor, true);
             }
-            iterator++;
          }
       }
 
+      unlock();
+
+      // In buffered mode, the MessageReader may already hold further
+      // messages. They have to be handled now, since poll() will not
+      // report them!
+   } while( (dataOkay) && (messageReader->hasBufferedMessage(socketDescriptor)) );
+}
+
+
+// ###### Statistics timer thread function ##################################
+// The sockets are handled by the ReceiverThreads. This thread merges the
+// per-flow statistics, i.e. it just handles the statistics timer.
+void FlowManager::run()
+{
+   signal(SIGPIPE, SIG_IGN);
+
+   do {
+      // ====== Wait for next statistics event ==============================
+      lock();
+      const unsigned long long nextEvent = getNextEvent();
+      unlock();
+
+      unsigned long long now = getMicroTime();
+      const int timeout = pollTimeout(now, 2,
+                                      now + 250000,
+                                      nextEvent);
+      ext_poll_wrapper(nullptr, 0, timeout);
+
       // ====== Handle statistics timer =====================================
+      lock();
+      now = getMicroTime();
       if(getNextEvent() <= now) {
          handleEvents(now);
       }
-
       unlock();
    } while(!isStopping());
 }
@@ -1068,7 +1565,8 @@ int createAndBindSocket(const int             family,
                         const unsigned int    localAddresses,
                         const sockaddr_union* localAddressArray,
                         const bool            listenMode,
-                        const bool            bindV6Only)
+                        const bool            bindV6Only,
+                        const bool            reusePort)
 {
    int sd = createSocket(family, type, protocol,
                          localAddresses, localAddressArray);
@@ -1080,6 +1578,15 @@ int createAndBindSocket(const int             family,
                           sd, strerror(errno)) << "\n";
          LOG_END
       }
+#if defined(SO_REUSEPORT)
+      if( (reusePort) &&
+          (ext_setsockopt(sd, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof(reuse)) < 0) ) {
+         LOG_WARNING
+         stdlog << format("Failed to configure port reuse (SO_REUSEPORT option) on socket %d: %s!",
+                          sd, strerror(errno)) << "\n";
+         LOG_END
+      }
+#endif
 
       const int success = bindSocket(sd, family, type, protocol,
                                      localPort, localAddresses, localAddressArray,
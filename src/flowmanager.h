@@ -32,6 +32,8 @@
 
 #include "thread.h"
 #include "messagereader.h"
+#include "receiverthread.h"
+#include "senderthread.h"
 #include "outputfile.h"
 #include "flowbandwidthstats.h"
 #include "flowtrafficspec.h"
@@ -41,6 +43,7 @@
 #include "tools.h"
 
 #include <map>
+#include <unordered_map>
 #include <vector>
 
 
@@ -49,6 +52,7 @@ class Flow;
 class FlowManager : public Thread
 {
    friend class Flow;
+   friend class ReceiverThread;
 
    // ====== Methods ========================================================
    protected:
@@ -59,8 +63,12 @@ class FlowManager : public Thread
    inline static FlowManager* getFlowManager() {
       return &FlowManagerSingleton;
    }
-   inline MessageReader* getMessageReader() {
-      return &Reader;
+   inline ReceiverThread* getReceiverThread(const int socketDescriptor) {
+      // The sockets are sharded among the receiver threads by descriptor:
+      return ReceiverThreads[(size_t)socketDescriptor % ReceiverThreads.size()];
+   }
+   inline MessageReader* getMessageReader(const int socketDescriptor) {
+      return getReceiverThread(socketDescriptor)->getMessageReader();
    }
    inline std::vector<Flow*>& getFlowSet() {   // Internal usage only!
       return FlowSet;
@@ -71,6 +79,24 @@ class FlowManager : public Thread
       DisplayEnabled = on;
       unlock();
    }
+   inline void configureConnectedUDP(const bool on) {
+      lock();
+      ConnectedUDP = on;
+      unlock();
+   }
+   inline void configureRandomSeed(const bool useSeed, const uint64_t seed) {
+      lock();
+      UseRandomSeed = useSeed;
+      RandomSeed    = seed;
+      unlock();
+   }
+   inline bool getRandomSeed(uint64_t& seed) const {
+      seed = RandomSeed;
+      return UseRandomSeed;
+   }
+   bool configureReceiverThreads(const unsigned int receiverThreads);
+   bool configureSenderThreads(const unsigned int senderThreads);
+   SenderThread* getSenderThread();
 
    void addUnidentifiedSocket(const int protocol, const int socketDescriptor);
    void removeUnidentifiedSocket(const int  socketDescriptor,
@@ -132,6 +158,21 @@ class FlowManager : public Thread
    // ====== Private Methods ================================================
    unsigned long long getNextEvent();
    void handleEvents(const unsigned long long now);
+   void updatePollSocket(const int socketDescriptor);
+   void removePollSocket(const int socketDescriptor);
+   void updateFlowIndex(Flow* flow);
+   int createConnectedUDPSocket(const int             udpSocket,
+                                const sockaddr_union* remoteAddress);
+   void indexFlow(Flow* flow);
+   void unindexFlow(Flow* flow);
+   void updateReceiverFlow(const int      socketDescriptor,
+                           const uint16_t streamID);
+   void handleSocketEvent(ReceiverThread*          receiverThread,
+                          const unsigned long long now,
+                          const int                socketDescriptor,
+                          const uint32_t           sequenceNumber);
+   bool handleSocketErrorEvent(const int      socketDescriptor,
+                               const uint32_t sequenceNumber);
 
 
    // ====== Private Data ===================================================
@@ -139,11 +180,64 @@ class FlowManager : public Thread
    static FlowManager                 FlowManagerSingleton;
 
    // ------ Flow Management ------------------------------------------------
-   MessageReader                      Reader;
    std::vector<Flow*>                 FlowSet;
+
+   // Hash indexes for findFlow(), kept in sync with FlowSet and with the
+   // flows' socket descriptors and remote addresses. If several flows share
+   // a key, the first indexed flow owns the entry.
+   struct FlowIDKey {
+      uint64_t MeasurementID;
+      uint32_t FlowID;
+      uint16_t StreamID;
+
+      inline bool operator==(const FlowIDKey& other) const {
+         return( (MeasurementID == other.MeasurementID) &&
+                 (FlowID        == other.FlowID) &&
+                 (StreamID      == other.StreamID) );
+      }
+   };
+   struct FlowIDKeyHash {
+      inline size_t operator()(const FlowIDKey& key) const {
+         return (size_t)mixBits64(key.MeasurementID ^
+                                  (((uint64_t)key.FlowID << 16) | key.StreamID));
+      }
+   };
+   struct FlowAddressKey {
+      uint32_t Address[4];   // IPv6 or IPv4-mapped IPv6 address
+      uint16_t Port;
+
+      inline bool operator==(const FlowAddressKey& other) const {
+         return( (Address[0] == other.Address[0]) &&
+                 (Address[1] == other.Address[1]) &&
+                 (Address[2] == other.Address[2]) &&
+                 (Address[3] == other.Address[3]) &&
+                 (Port       == other.Port) );
+      }
+   };
+   struct FlowAddressKeyHash {
+      inline size_t operator()(const FlowAddressKey& key) const {
+         return (size_t)mixBits64(((uint64_t)key.Address[0] << 32) ^ key.Address[1] ^
+                                  ((uint64_t)key.Address[2] << 32) ^ key.Address[3] ^
+                                  ((uint64_t)key.Port << 48));
+      }
+   };
+   static bool getFlowAddressKey(const struct sockaddr* address,
+                                 FlowAddressKey&        key);
+   static inline uint64_t getFlowSocketKey(const int      socketDescriptor,
+                                           const uint16_t streamID) {
+      return ((uint64_t)(uint32_t)socketDescriptor << 16) | streamID;
+   }
+   std::unordered_map<FlowIDKey, Flow*, FlowIDKeyHash>           FlowIDIndex;
+   std::unordered_map<uint64_t, Flow*>                           FlowSocketIndex;
+   std::unordered_map<int, std::vector<Flow*>>                   FlowSocketHandlerIndex;
+   std::unordered_map<FlowAddressKey, Flow*, FlowAddressKeyHash> FlowAddressIndex;
    FlowBandwidthStats                 CurrentGlobalStats;
    FlowBandwidthStats                 LastGlobalStats;
    bool                               DisplayEnabled;
+   bool                               ConnectedUDP;   // Own UDP socket per incoming flow
+   int                                UDPSocket;      // Global UDP socket (passive side)
+   bool                               UseRandomSeed;
+   uint64_t                           RandomSeed;     // Base of the flows' random streams
 
    // ------ Measurement Management -----------------------------------------
    std::map<std::pair<int, uint64_t>,
@@ -160,11 +254,26 @@ class FlowManager : public Thread
    struct UnidentifiedSocket {
       int     SocketDescriptor;
       int     Protocol;
-      pollfd* PollFDEntry;
-      bool    ToBeRemoved;
-      bool    ToBeClosed;
    };
    std::map<int, UnidentifiedSocket*> UnidentifiedSockets;
+
+   // ------ Poll Management ------------------------------------------------
+   // Sockets to wait for, with the Flow or UnidentifiedSocket handling
+   // their input. The sequence number identifies a registration, i.e. it
+   // allows to detect stale events for a reused socket descriptor.
+   // The sockets are waited for by the ReceiverThreads.
+   struct PollSocket {
+      Flow*               FlowHandler;
+      UnidentifiedSocket* UnidentifiedHandler;
+      uint32_t            SequenceNumber;
+   };
+   std::map<int, PollSocket>          PollSockets;
+   uint32_t                           PollSequenceNumber;
+   std::vector<ReceiverThread*>       ReceiverThreads;
+
+   // ------ Sender Management ----------------------------------------------
+   // If there are no SenderThreads, each Flow uses its own thread.
+   std::vector<SenderThread*>         SenderThreads;
 };
 
 
@@ -175,7 +284,8 @@ int createAndBindSocket(const int             family,
                         const unsigned int    localAddresses,
                         const sockaddr_union* localAddressArray,
                         const bool            listenMode,
-                        const bool            bindV6Only);
+                        const bool            bindV6Only,
+                        const bool            reusePort = false);
 bool setBufferSizes(int sd, const int sndBufSize, const int rcvBufSize);
 
 #endif
@@ -43,6 +43,22 @@ FlowTrafficSpec::~FlowTrafficSpec()
 }
 
 
+// ###### Get name of pacing mode ###########################################
+const char* FlowTrafficSpec::getPacingName(const PacingMode pacing)
+{
+   switch(pacing) {
+      case PrecisePacing:
+         return "precise";
+      case SpinPacing:
+         return "spin";
+      case KernelPacing:
+         return "kernel";
+      default:
+         return "default";
+   }
+}
+
+
 // ###### Show configuration entry (value + random number generator) ########
 void FlowTrafficSpec::showEntry(std::ostream& os,
                                 const double* valueArray,
@@ -75,6 +91,9 @@ void FlowTrafficSpec::showEntry(std::ostream& os,
          snprintf((char*)&str, sizeof(str), "mean=%1.6lf, stddev=%1.6lf (truncated normal)",
                   valueArray[0], valueArray[1]);
        break;
+      case RANDOM_TRACE:
+         snprintf((char*)&str, sizeof(str), "(trace)");
+       break;
       default:
          snprintf((char*)&str, sizeof(str), "unknown?!");
        break;
@@ -93,8 +112,14 @@ void FlowTrafficSpec::print(std::ostream& os) const
    os << " - Defragment Timeout:  " << DefragmentTimeout / 1000 << "ms\n";
    os << " - Outbound Frame Rate: ";
    showEntry(os, (const double*)&OutboundFrameRate, OutboundFrameRateRng);
+   if(OutboundFrameRateRng == RANDOM_TRACE) {
+      os << OutboundFrameRateTrace << " ";
+   }
    os << "\n - Outbound Frame Size: ";
    showEntry(os, (const double*)&OutboundFrameSize, OutboundFrameSizeRng);
+   if(OutboundFrameSizeRng == RANDOM_TRACE) {
+      os << OutboundFrameSizeTrace << " ";
+   }
    os << "\n - Inbound Frame Rate:  ";
    showEntry(os, (const double*)&InboundFrameRate, InboundFrameRateRng);
    os << "\n - Inbound Frame Size:  ";
@@ -134,6 +159,8 @@ void FlowTrafficSpec::print(std::ostream& os) const
    os << "}\n"
       << " - Repeat On/Off:       " << ((RepeatOnOff == true) ? "yes" : "no") << "\n";
 
+   os << " - Pacing:              "
+      << getPacingName(Pacing) << "\n";
    os << " - Error on Abort:      "
       << ((ErrorOnAbort == true) ? "yes" : "no") << "\n";
    if( (Protocol == IPPROTO_SCTP) || (Protocol == IPPROTO_TCP)
@@ -144,12 +171,18 @@ void FlowTrafficSpec::print(std::ostream& os) const
       os << " - No Delay:            "
          << ((NoDelay == true) ? "yes" : "no") << "\n";
    }
+   if(Protocol == IPPROTO_UDP) {
+      os << " - GSO:                 "
+         << ((UseGSO == true) ? "yes" : "no") << "\n";
+   }
    if( (Protocol == IPPROTO_TCP)
 #if defined(HAVE_MPTCP)
        || (Protocol == IPPROTO_MPTCP)
 #endif
      ) {
       os << " - Congestion Control:  " << CongestionControl << "\n";
+      os << " - Zero Copy:           "
+         << ((UseZeroCopy == true) ? "yes" : "no") << "\n";
    }
    if(Protocol == IPPROTO_SCTP) {
       os << " - CMT:                 #" << (unsigned int)CMT << " ";
@@ -194,6 +227,9 @@ void FlowTrafficSpec::reset()
    ErrorOnAbort             = true;
    Debug                    = false;
    NoDelay                  = false;
+   UseGSO                   = false;
+   UseZeroCopy              = false;
+   Pacing                   = DefaultPacing;
    BindV6Only               = false;
    RepeatOnOff              = false;
    CongestionControl        = "default";
@@ -206,6 +242,8 @@ void FlowTrafficSpec::reset()
       InboundFrameSize[i]  = 0.0;
    }
    OutboundFrameRateRng = RANDOM_CONSTANT;
+   OutboundFrameRateTrace.clear();
+   OutboundFrameSizeTrace.clear();
    OutboundFrameSizeRng = RANDOM_CONSTANT;
    InboundFrameRateRng  = RANDOM_CONSTANT;
    InboundFrameSizeRng  = RANDOM_CONSTANT;
@@ -49,6 +49,13 @@ class FlowTrafficSpec
 {
    // ====== Methods ========================================================
    public:
+   enum PacingMode {
+      DefaultPacing = 0,   // Wait by poll() timeout (millisecond granularity)
+      PrecisePacing = 1,   // Wait by absolute clock_nanosleep()
+      SpinPacing    = 2,   // Like PrecisePacing, with final busy-waiting
+      KernelPacing  = 3    // Paced by the kernel (SO_MAX_PACING_RATE/SO_TXTIME)
+   };
+
    FlowTrafficSpec();
    ~FlowTrafficSpec();
 
@@ -68,6 +75,7 @@ class FlowTrafficSpec
    // ====== Public Data ====================================================
    public:
    static void showEntry(std::ostream& os, const double* valueArray, const uint8_t rng);
+   static const char* getPacingName(const PacingMode pacing);
 
    std::string             Description;
    int                     Protocol;
@@ -92,6 +100,8 @@ class FlowTrafficSpec
    uint8_t                 OutboundFrameSizeRng;
    uint8_t                 InboundFrameRateRng;
    uint8_t                 InboundFrameSizeRng;
+   std::string             OutboundFrameRateTrace;   // Trace file for RANDOM_TRACE
+   std::string             OutboundFrameSizeTrace;   // Trace file for RANDOM_TRACE
 
    uint8_t                 CMT;
    uint8_t                 CCID;
@@ -99,6 +109,9 @@ class FlowTrafficSpec
 
    bool                    Debug;
    bool                    NoDelay;
+   bool                    UseGSO;
+   bool                    UseZeroCopy;
+   PacingMode              Pacing;
    bool                    ErrorOnAbort;
    bool                    RepeatOnOff;
    bool                    BindV6Only;
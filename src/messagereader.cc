@@ -43,8 +43,9 @@
 
 
 // ###### Constructor #######################################################
-MessageReader::MessageReader()
+MessageReader::MessageReader(const size_t streamBufferSize)
 {
+   StreamBufferSize = streamBufferSize;
 }
 
 
@@ -67,6 +68,7 @@ bool MessageReader::registerSocket(const int    protocol,
                                    const size_t maxMessageSize)
 {
    Socket*                          socket;
+   lock();
    std::map<int, Socket*>::iterator found = SocketMap.find(sd);
    if(found == SocketMap.end()) {
       assure(maxMessageSize >= sizeof(TLVHeader));
@@ -82,6 +84,45 @@ bool MessageReader::registerSocket(const int    protocol,
       socket->Protocol          = protocol;
       socket->SocketDescriptor  = sd;
       socket->UseCount          = 1;
+      socket->StreamBuffer      = nullptr;
+      socket->StreamBufferStart = 0;
+      socket->StreamBufferEnd   = 0;
+      if( (StreamBufferSize >= maxMessageSize) &&
+          ( (protocol == IPPROTO_TCP)
+#if defined(HAVE_MPTCP)
+            || (protocol == IPPROTO_MPTCP)
+#endif
+          ) ) {
+         socket->StreamBuffer = new char[StreamBufferSize];
+         assure(socket->StreamBuffer != nullptr);
+      }
+      // ====== Choose protocol-specific receive function ===================
+      if(protocol == IPPROTO_UDP) {
+         socket->Receive = &MessageReader::receiveDatagramMessage;
+      }
+      else if(socket->StreamBuffer != nullptr) {
+         socket->Receive = &MessageReader::receiveBufferedMessage;
+      }
+#if defined(HAVE_SCTP)
+      else if(protocol == IPPROTO_SCTP) {
+         socket->Receive = &MessageReader::receiveSCTPMessage;
+      }
+#endif
+#if defined(HAVE_QUIC)
+      else if(protocol == IPPROTO_QUIC) {
+         socket->Receive = &MessageReader::receiveQUICMessage;
+      }
+#endif
+      else if( (protocol == IPPROTO_TCP)
+#if defined(HAVE_MPTCP)
+               || (protocol == IPPROTO_MPTCP)
+#endif
+             ) {
+         socket->Receive = &MessageReader::receiveStreamMessage;
+      }
+      else {
+         socket->Receive = &MessageReader::receivePacketMessage;
+      }
       SocketMap.insert(std::pair<int, Socket*>(sd, socket));
    }
    else {
@@ -99,6 +140,7 @@ bool MessageReader::registerSocket(const int    protocol,
    printf("RegisterSocket: UseCount[sd=%d,proto=%d]=%u\n",
           socket->SocketDescriptor, socket->Protocol, (unsigned int)socket->UseCount);
 #endif
+   unlock();
    return true;
 }
 
@@ -106,6 +148,8 @@ bool MessageReader::registerSocket(const int    protocol,
 // ###### Deregister a socket ###############################################
 bool MessageReader::deregisterSocket(const int sd)
 {
+   bool result = true;
+   lock();
    std::map<int, Socket*>::iterator found = SocketMap.find(sd);
    if(found != SocketMap.end()) {
       Socket* socket = found->second;
@@ -116,24 +160,168 @@ bool MessageReader::deregisterSocket(const int sd)
 #endif
       if(socket->UseCount == 0) {
          SocketMap.erase(found);
+         delete [] socket->StreamBuffer;
          delete [] socket->MessageBuffer;
          delete socket;
-         return true;
       }
-      return false;   // Socket is still in use!
+      else {
+         result = false;   // Socket is still in use!
+      }
    }
-   return true;
+   unlock();
+   return result;
+}
+
+
+// ###### Check, whether a complete message is already buffered ############
+bool MessageReader::hasBufferedMessage(const int sd)
+{
+   bool result = false;
+   lock();
+   const Socket* socket = getSocket(sd);
+   if( (socket != nullptr) && (socket->StreamBuffer != nullptr) &&
+       (socket->Status == Socket::MRS_WaitingForHeader) ) {
+      const size_t available = socket->StreamBufferEnd - socket->StreamBufferStart;
+      if(available >= sizeof(TLVHeader)) {
+         const TLVHeader* header =
+            (const TLVHeader*)&socket->StreamBuffer[socket->StreamBufferStart];
+         // NOTE: An invalid length is also reported here. The following
+         //       receiveMessage() call will then report the stream error.
+         const size_t messageSize = be16toh(header->Length);
+         result = ( (messageSize < sizeof(TLVHeader)) ||
+                    (messageSize > socket->MessageBufferSize) ||
+                    (available >= messageSize) );
+      }
+   }
+   unlock();
+   return result;
+}
+
+
+// ###### Extract message from stream buffer ################################
+ssize_t MessageReader::extractBufferedMessage(Socket* socket,
+                                              void*   buffer,
+                                              size_t  bufferSize)
+{
+   const size_t available = socket->StreamBufferEnd - socket->StreamBufferStart;
+   if(available < sizeof(TLVHeader)) {
+      return MRRM_PARTIAL_READ;
+   }
+   const TLVHeader* header =
+      (const TLVHeader*)&socket->StreamBuffer[socket->StreamBufferStart];
+#if defined(DEBUG_MESSAGEREADER)
+   printf("Socket %d:   header T=%u F=%02x L=%u   [Buffered %u]\n",
+          socket->SocketDescriptor,
+          (unsigned int)header->Type, (unsigned int)header->Flags,
+          be16toh(header->Length), (unsigned int)available);
+#endif
+   const size_t messageSize = be16toh(header->Length);
+   if(messageSize < sizeof(TLVHeader)) {
+      LOG_WARNING
+      stdlog << format("Message size < TLV size in message from socket %d!",
+                       socket->SocketDescriptor) << "\n";
+      LOG_END
+      socket->Status = Socket::MRS_StreamError;
+      return MRRM_STREAM_ERROR;
+   }
+   else if(messageSize > socket->MessageBufferSize) {
+      LOG_WARNING
+      stdlog << format("Message too large to fit buffer for message from socket %d!",
+                       socket->SocketDescriptor) << "\n";
+      LOG_END
+      socket->Status = Socket::MRS_StreamError;
+      return MRRM_STREAM_ERROR;
+   }
+   if(available < messageSize) {
+      return MRRM_PARTIAL_READ;
+   }
+   if(messageSize > bufferSize) {
+      LOG_WARNING
+      stdlog << format("Buffer size is too small (buffer %u, message %u) for message from socket %d!",
+                       (unsigned int)bufferSize, (unsigned int)messageSize,
+                       socket->SocketDescriptor) << "\n";
+      LOG_END
+      socket->Status = Socket::MRS_StreamError;
+      return MRRM_STREAM_ERROR;
+   }
+   memcpy(buffer, header, messageSize);
+   socket->StreamBufferStart += messageSize;
+   if(socket->StreamBufferStart == socket->StreamBufferEnd) {
+      socket->StreamBufferStart = 0;
+      socket->StreamBufferEnd   = 0;
+   }
+   return (ssize_t)messageSize;
+}
+
+
+// ###### Receive full message in buffered mode #############################
+// Instead of reading TLV header and message separately, as much data as
+// possible is read into the stream buffer. Further messages in the buffer
+// are then handed out without any system call, see hasBufferedMessage().
+ssize_t MessageReader::receiveBufferedMessage(Socket*    socket,
+                                              void*      buffer,
+                                              size_t     bufferSize,
+                                              sockaddr*  from,
+                                              socklen_t* fromSize,
+                                              int64_t*   streamID,
+                                              int*       msgFlags)
+{
+   if(socket->Status == Socket::MRS_StreamError) {
+      // Not useful to retry when synchronization has been lost!
+      return MRRM_STREAM_ERROR;
+   }
+
+   // ====== Try to use already buffered message ============================
+   ssize_t result = extractBufferedMessage(socket, buffer, bufferSize);
+   if(result != MRRM_PARTIAL_READ) {
+      return result;
+   }
+
+   // ====== Read from socket ===============================================
+   if(socket->StreamBufferStart > 0) {
+      // Move the beginning of a partial message to the front of the buffer:
+      memmove(socket->StreamBuffer,
+              &socket->StreamBuffer[socket->StreamBufferStart],
+              socket->StreamBufferEnd - socket->StreamBufferStart);
+      socket->StreamBufferEnd   -= socket->StreamBufferStart;
+      socket->StreamBufferStart  = 0;
+   }
+   int flags;
+   if(msgFlags == nullptr) {
+      flags    = 0;
+      msgFlags = &flags;
+   }
+   if(from) {
+      memset(from, 0, *fromSize);   // Clear address (Valgrind report)
+   }
+   const ssize_t received =
+      ext_recvfrom(socket->SocketDescriptor,
+                   &socket->StreamBuffer[socket->StreamBufferEnd],
+                   StreamBufferSize - socket->StreamBufferEnd,
+                   *msgFlags, from, fromSize);
+   if(received < 0) {
+      return MRRM_SOCKET_ERROR;
+   }
+   else if(received == 0) {
+      return received;   // Shutdown
+   }
+   socket->StreamBufferEnd += (size_t)received;
+
+   // ====== Get first message ==============================================
+   return extractBufferedMessage(socket, buffer, bufferSize);
 }
 
 
 // ###### Get all socket descriptors ########################################
 size_t MessageReader::getAllSDs(int* sds, const size_t maxEntries)
 {
+   lock();
    assure(maxEntries >= SocketMap.size());
    size_t count = 0;
    for(std::map<int, Socket*>::iterator iterator = SocketMap.begin(); iterator != SocketMap.end(); iterator++) {
       sds[count++] = iterator->second->SocketDescriptor;
    }
+   unlock();
    return count;
 }
 
@@ -146,248 +334,378 @@ ssize_t MessageReader::receiveMessage(const int        sd,
                                       socklen_t*       fromSize,
                                       int64_t*         streamID,
                                       int*             msgFlags)
+{
+   // The socket state must not be modified or removed while reading:
+   lock();
+   const ssize_t result = receiveSocketMessage(sd, buffer, bufferSize,
+                                               from, fromSize, streamID, msgFlags);
+   unlock();
+   return result;
+}
+
+
+// ###### Receive full message (MessageReader must be locked) ##############
+ssize_t MessageReader::receiveSocketMessage(const int        sd,
+                                            void*            buffer,
+                                            size_t           bufferSize,
+                                            sockaddr*        from,
+                                            socklen_t*       fromSize,
+                                            int64_t*         streamID,
+                                            int*             msgFlags)
 {
    Socket* socket = getSocket(sd);
    if(socket != nullptr) {
-      // ===== UDP ==========================================================
-      if(socket->Protocol == IPPROTO_UDP) {
-         // For UDP, reading always returns a full message. There is no
-         // particul reading!
-         const ssize_t received =
-            ext_recvfrom(socket->SocketDescriptor,
-                         buffer, bufferSize,
-                         *msgFlags, from, fromSize);
-         return received;
-      }
+      // The protocol-specific receive function has been chosen by
+      // registerSocket():
+      return (this->*socket->Receive)(socket, buffer, bufferSize,
+                                      from, fromSize, streamID, msgFlags);
+   }
 
-      // ====== Find out the number of bytes to read ========================
-      ssize_t received;
-      size_t  bytesToRead;
-      if( (socket->Protocol == IPPROTO_TCP)
-#if defined(HAVE_SCTP)
-          || (socket->Protocol == IPPROTO_SCTP)
-#endif
-#if defined(HAVE_MPTCP)
-          || (socket->Protocol == IPPROTO_MPTCP)
-#endif
-#if defined(HAVE_QUIC)
-          || (socket->Protocol == IPPROTO_QUIC)
-#endif
-          || (false)   /* Avoid compile warning without any #ifdef case */
-        ) {
-         // SCTP, TCP/MPTCP and QUIC can return partial messages upon recv() calls.
-         // TCP/MPTCP and QUIC may even return multiple messages, if the buffer
-         // size is large enough!
-         if(socket->Status == Socket::MRS_WaitingForHeader) {
-            assure(sizeof(TLVHeader) >= socket->BytesRead);
-            bytesToRead = sizeof(TLVHeader) - socket->BytesRead;
-         }
-         else if(socket->Status == Socket::MRS_PartialRead) {
-            bytesToRead = socket->MessageSize - socket->BytesRead;
-         }
-         else {
-#if defined(HAVE_SCTP)
-            if(socket->Protocol == IPPROTO_SCTP) {
-               // An error occurred before. Reset and try again ...
-               socket->Status    = Socket::MRS_WaitingForHeader;
-               socket->BytesRead = 0;
-               bytesToRead       = sizeof(TLVHeader);
-            }
-            else {
-#endif
-               // Not useful to retry when synchronization has been lost!
-               return MRRM_STREAM_ERROR;
-#if defined(HAVE_SCTP)
-            }
-#endif
-         }
-         assure(bytesToRead + socket->BytesRead <= socket->MessageBufferSize);
-      }
-      else {
-         // DCCP and UDP will always return only a single message on recv() calls.
-         bytesToRead = socket->MessageBufferSize;
-      }
+   LOG_ERROR
+   stdlog << format("Invalid socket %d!", sd) << "\n";
+   LOG_END
+   return MRRM_BAD_SOCKET;
+}
 
 
-      // ====== Read from socket ============================================
-      int flags;
-      if(msgFlags == nullptr) {
-         flags    = 0;
-         msgFlags = &flags;
-      }
-      if(from) {
-         memset(from, 0, *fromSize);   // Clear address (Valgrind report)
-      }
-      if(0) { /* Dummy for following "else if" in #if ... #endif block */ }
-#if defined(HAVE_SCTP)
-      else if(socket->Protocol == IPPROTO_SCTP) {
-         sctp_sndrcvinfo sinfo;
-         received = sctp_recvmsg(socket->SocketDescriptor,
-                                 (char*)&socket->MessageBuffer[socket->BytesRead], bytesToRead,
-                                 from, fromSize, &sinfo, msgFlags);
-         if(streamID != nullptr) {
-            *streamID = (int64_t)sinfo.sinfo_stream;
-         }
-      }
-#endif
-#if defined(HAVE_QUIC)
-      else if(socket->Protocol == IPPROTO_QUIC) {
-         uint32_t flags = 0;
-         received = quic_recvmsg(socket->SocketDescriptor,
-                                 (char*)&socket->MessageBuffer[socket->BytesRead], bytesToRead,
-                                 streamID, &flags);
-      }
-#endif
-      else {
-         received = ext_recvfrom(socket->SocketDescriptor,
-                                 (char*)&socket->MessageBuffer[socket->BytesRead], bytesToRead,
-                                 *msgFlags, from, fromSize);
-      }
+// ###### Receive datagram message (UDP) ####################################
+ssize_t MessageReader::receiveDatagramMessage(Socket*    socket,
+                                              void*      buffer,
+                                              size_t     bufferSize,
+                                              sockaddr*  from,
+                                              socklen_t* fromSize,
+                                              int64_t*   streamID,
+                                              int*       msgFlags)
+{
+   // For UDP, reading always returns a full message. There is no
+   // particul reading!
+   const ssize_t received =
+      ext_recvfrom(socket->SocketDescriptor,
+                   buffer, bufferSize,
+                   *msgFlags, from, fromSize);
+   return received;
+}
 
 
-      // ====== Handle received data ========================================
-      if(received > 0) {
-         socket->BytesRead += (size_t)received;
-         // ====== Handle message header ====================================
-         if(socket->Status == Socket::MRS_WaitingForHeader) {
-#if defined(HAVE_SCTP)
-            // ====== Handle SCTP notification header =======================
-            if((socket->Protocol == IPPROTO_SCTP) && (*msgFlags & MSG_NOTIFICATION)) {
-#if defined(DEBUG_MESSAGEREADER)
-                  printf("Socket %d:   notification L=%u\n",
-                         socket->SocketDescriptor,
-                         (unsigned int)sizeof(sctp_notification));
-#endif
-               socket->MessageSize = sizeof(sctp_notification);   // maximum length
-               socket->Status      = Socket::MRS_PartialRead;
-               // SCTP notification has no TLV header, but must be handled like
-               // a message. The actual length of the notification is unknown, we
-               // need to look for MSG_EOF!
-            }
-            // ====== Handle TLV header =====================================
-            else {
-#endif
-               if(socket->BytesRead >= sizeof(TLVHeader)) {
-                  const TLVHeader* header = (const TLVHeader*)socket->MessageBuffer;
+// ###### Get number of bytes to read for next part of TLV message #########
+// For protocols which may return partial messages upon recv() calls.
+ssize_t MessageReader::getFramedBytesToRead(Socket* socket,
+                                            size_t& bytesToRead)
+{
+   if(socket->Status == Socket::MRS_WaitingForHeader) {
+      assure(sizeof(TLVHeader) >= socket->BytesRead);
+      bytesToRead = sizeof(TLVHeader) - socket->BytesRead;
+   }
+   else if(socket->Status == Socket::MRS_PartialRead) {
+      bytesToRead = socket->MessageSize - socket->BytesRead;
+   }
+   else {
+      // Not useful to retry when synchronization has been lost!
+      return MRRM_STREAM_ERROR;
+   }
+   assure(bytesToRead + socket->BytesRead <= socket->MessageBufferSize);
+   return 0;
+}
+
+
+// ###### Handle TLV header of message being read ###########################
+// Returns 0 if the header is complete, i.e. the payload is read next.
+ssize_t MessageReader::handleTLVHeader(Socket* socket)
+{
+   if(socket->BytesRead < sizeof(TLVHeader)) {
+      return MRRM_PARTIAL_READ;
+   }
+   const TLVHeader* header = (const TLVHeader*)socket->MessageBuffer;
 #if defined(DEBUG_MESSAGEREADER)
-                  printf("Socket %d:   header T=%u F=%02x L=%u   [Header]\n",
-                          socket->SocketDescriptor,
-                          (unsigned int)header->Type, (unsigned int)header->Flags,
-                         be16toh(header->Length));
-#endif
-                  socket->MessageSize = be16toh(header->Length);
-                  if(socket->MessageSize < sizeof(TLVHeader)) {
-                     LOG_WARNING
-                     stdlog << format("Message size < TLV size in message from socket %d!",
-                                      socket->SocketDescriptor) << "\n";
-                     LOG_END
-                     socket->Status = Socket::MRS_StreamError;
-                     return MRRM_STREAM_ERROR;
-                  }
-                  else if(socket->MessageSize > socket->MessageBufferSize) {
-                     LOG_WARNING
-                     stdlog << format("Message too large to fit buffer for message from socket %d!",
-                                      socket->SocketDescriptor) << "\n";
-                     LOG_END
-                     socket->Status = Socket::MRS_StreamError;
-                     return MRRM_STREAM_ERROR;
-                  }
-                  socket->Status = Socket::MRS_PartialRead;
-               }
-               else {
-                  return MRRM_PARTIAL_READ;
-               }
-#if defined(HAVE_SCTP)
-            }
+   printf("Socket %d:   header T=%u F=%02x L=%u   [Header]\n",
+          socket->SocketDescriptor,
+          (unsigned int)header->Type, (unsigned int)header->Flags,
+          be16toh(header->Length));
 #endif
-            // Continue here with MRS_PartialRead status!
-            // (will return MRRM_PARTIAL_READ, or message on header-only message)
-         }
+   socket->MessageSize = be16toh(header->Length);
+   if(socket->MessageSize < sizeof(TLVHeader)) {
+      LOG_WARNING
+      stdlog << format("Message size < TLV size in message from socket %d!",
+                       socket->SocketDescriptor) << "\n";
+      LOG_END
+      socket->Status = Socket::MRS_StreamError;
+      return MRRM_STREAM_ERROR;
+   }
+   else if(socket->MessageSize > socket->MessageBufferSize) {
+      LOG_WARNING
+      stdlog << format("Message too large to fit buffer for message from socket %d!",
+                       socket->SocketDescriptor) << "\n";
+      LOG_END
+      socket->Status = Socket::MRS_StreamError;
+      return MRRM_STREAM_ERROR;
+   }
+   socket->Status = Socket::MRS_PartialRead;
+   return 0;
+}
+
 
-         // ====== Handle message payload ===================================
-         if(socket->Status == Socket::MRS_PartialRead) {
+// ###### Hand completely read message to the caller ########################
+ssize_t MessageReader::completeFramedMessage(Socket* socket,
+                                             void*   buffer,
+                                             size_t  bufferSize)
+{
+   if(socket->MessageSize > bufferSize) {
+      LOG_WARNING
+      stdlog << format("Buffer size is too small (buffer %u, message %u) for message from socket %d!",
+                       (unsigned int)bufferSize, (unsigned int)socket->MessageSize,
+                       socket->SocketDescriptor) << "\n";
+      LOG_END
+      socket->Status = Socket::MRS_StreamError;
+      return MRRM_STREAM_ERROR;
+   }
+   const ssize_t received = (ssize_t)socket->MessageSize;
+   memcpy(buffer, socket->MessageBuffer, socket->MessageSize);
+   socket->Status      = Socket::MRS_WaitingForHeader;
+   socket->MessageSize = 0;
+   socket->BytesRead   = 0;
+   return received;
+}
+
+
+// ###### Handle data read for TLV-framed message ###########################
+// Common part of TCP/MPTCP (if not in buffered mode), QUIC and DCCP.
+ssize_t MessageReader::handleFramedData(Socket*       socket,
+                                        const ssize_t received,
+                                        void*         buffer,
+                                        size_t        bufferSize)
+{
+   // ====== Handle read errors and shutdown ================================
+   if(received <= 0) {
+      return (received < 0) ? MRRM_SOCKET_ERROR : received;
+   }
+   socket->BytesRead += (size_t)received;
+
+   // ====== Handle message header ==========================================
+   if(socket->Status == Socket::MRS_WaitingForHeader) {
+      const ssize_t result = handleTLVHeader(socket);
+      if(result != 0) {
+         return result;
+      }
+      // Continue here with MRS_PartialRead status!
+      // (will return MRRM_PARTIAL_READ, or message on header-only message)
+   }
+
+   // ====== Handle message payload =========================================
+   if(socket->Status == Socket::MRS_PartialRead) {
 #if defined(DEBUG_MESSAGEREADER)
-            printf("Socket %d:   partial read T=%u F=%02x L=%u   [%u/%u]\n",
-                   socket->SocketDescriptor,
-                   ((const TLVHeader*)socket->MessageBuffer)->Type,
-                   ((const TLVHeader*)socket->MessageBuffer)->Flags,
-                   be16toh(((const TLVHeader*)socket->MessageBuffer)->Length),
-                   (unsigned int)socket->BytesRead,
-                   (unsigned int)socket->MessageSize);
+      printf("Socket %d:   partial read T=%u F=%02x L=%u   [%u/%u]\n",
+             socket->SocketDescriptor,
+             ((const TLVHeader*)socket->MessageBuffer)->Type,
+             ((const TLVHeader*)socket->MessageBuffer)->Flags,
+             be16toh(((const TLVHeader*)socket->MessageBuffer)->Length),
+             (unsigned int)socket->BytesRead,
+             (unsigned int)socket->MessageSize);
 #endif
+      if(socket->BytesRead < socket->MessageSize) {
+         return MRRM_PARTIAL_READ;
+      }
+      return completeFramedMessage(socket, buffer, bufferSize);
+   }
+   return MRRM_BAD_SOCKET;
+}
 
-            // ====== Partially read message ================================
-            if(socket->BytesRead < socket->MessageSize) {
-#if defined(HAVE_SCTP)
-               if(socket->Protocol == IPPROTO_SCTP) {
-                  if(*msgFlags & MSG_EOR) {   // end of SCTP message
-                     if(!(*msgFlags & MSG_NOTIFICATION)) {   // data message
-                        LOG_WARNING
-                        stdlog << format("SCTP message end before TLV message end (read %u, expected %u) for message from socket %d!",
-                                         socket->SocketDescriptor,
-                                         (unsigned int)socket->BytesRead,
-                                         (unsigned int)socket->MessageSize) << "\n";
-                        LOG_END
-                        socket->Status = Socket::MRS_StreamError;
-                        return MRRM_STREAM_ERROR;
-                     }
-                     // This is the end of the SCTP notification. The message
-                     // is complete here. Return it to the caller.
-                     socket->MessageSize = socket->BytesRead;
-                  }
-                  else {
-                     return MRRM_PARTIAL_READ;
-                  }
-               }
-               else {
+
+// ###### Receive full message of TLV-framed stream (TCP/MPTCP) #############
+// Used if not in buffered mode. TCP/MPTCP can return partial messages upon
+// recv() calls, or even multiple messages if the buffer size is large
+// enough. Therefore, the TLV header is read first, then the rest of the
+// message.
+ssize_t MessageReader::receiveStreamMessage(Socket*    socket,
+                                            void*      buffer,
+                                            size_t     bufferSize,
+                                            sockaddr*  from,
+                                            socklen_t* fromSize,
+                                            int64_t*   streamID,
+                                            int*       msgFlags)
+{
+   size_t        bytesToRead;
+   const ssize_t result = getFramedBytesToRead(socket, bytesToRead);
+   if(result < 0) {
+      return result;
+   }
+
+   int flags;
+   if(msgFlags == nullptr) {
+      flags    = 0;
+      msgFlags = &flags;
+   }
+   if(from) {
+      memset(from, 0, *fromSize);   // Clear address (Valgrind report)
+   }
+   const ssize_t received =
+      ext_recvfrom(socket->SocketDescriptor,
+                   (char*)&socket->MessageBuffer[socket->BytesRead], bytesToRead,
+                   *msgFlags, from, fromSize);
+   return handleFramedData(socket, received, buffer, bufferSize);
+}
+
+
+// ###### Receive full message of TLV-framed datagrams (DCCP) ###############
+// DCCP will always return only a single message on recv() calls.
+ssize_t MessageReader::receivePacketMessage(Socket*    socket,
+                                            void*      buffer,
+                                            size_t     bufferSize,
+                                            sockaddr*  from,
+                                            socklen_t* fromSize,
+                                            int64_t*   streamID,
+                                            int*       msgFlags)
+{
+   int flags;
+   if(msgFlags == nullptr) {
+      flags    = 0;
+      msgFlags = &flags;
+   }
+   if(from) {
+      memset(from, 0, *fromSize);   // Clear address (Valgrind report)
+   }
+   const ssize_t received =
+      ext_recvfrom(socket->SocketDescriptor,
+                   (char*)&socket->MessageBuffer[socket->BytesRead],
+                   socket->MessageBufferSize - socket->BytesRead,
+                   *msgFlags, from, fromSize);
+   return handleFramedData(socket, received, buffer, bufferSize);
+}
+
+
+#if defined(HAVE_QUIC)
+// ###### Receive full message of TLV-framed QUIC stream ####################
+// QUIC can return partial messages upon recv() calls, or even multiple
+// messages if the buffer size is large enough. Therefore, the TLV header is
+// read first, then the rest of the message.
+ssize_t MessageReader::receiveQUICMessage(Socket*    socket,
+                                          void*      buffer,
+                                          size_t     bufferSize,
+                                          sockaddr*  from,
+                                          socklen_t* fromSize,
+                                          int64_t*   streamID,
+                                          int*       msgFlags)
+{
+   size_t        bytesToRead;
+   const ssize_t result = getFramedBytesToRead(socket, bytesToRead);
+   if(result < 0) {
+      return result;
+   }
+
+   if(from) {
+      memset(from, 0, *fromSize);   // Clear address (Valgrind report)
+   }
+   uint32_t flags = 0;
+   const ssize_t received =
+      quic_recvmsg(socket->SocketDescriptor,
+                   (char*)&socket->MessageBuffer[socket->BytesRead], bytesToRead,
+                   streamID, &flags);
+   return handleFramedData(socket, received, buffer, bufferSize);
+}
 #endif
-                  return MRRM_PARTIAL_READ;
+
+
 #if defined(HAVE_SCTP)
-               }
+// ###### Receive full message of TLV-framed SCTP association ###############
+// SCTP can return partial messages upon recv() calls. Furthermore, the TLV
+// message end has to match the SCTP message end, and SCTP notifications
+// (which have no TLV header) are handed out like messages.
+ssize_t MessageReader::receiveSCTPMessage(Socket*    socket,
+                                          void*      buffer,
+                                          size_t     bufferSize,
+                                          sockaddr*  from,
+                                          socklen_t* fromSize,
+                                          int64_t*   streamID,
+                                          int*       msgFlags)
+{
+   // ====== Find out the number of bytes to read ===========================
+   if(socket->Status == Socket::MRS_StreamError) {
+      // An error occurred before. Reset and try again ...
+      socket->Status    = Socket::MRS_WaitingForHeader;
+      socket->BytesRead = 0;
+   }
+   size_t bytesToRead;
+   getFramedBytesToRead(socket, bytesToRead);
+
+   // ====== Read from socket ===============================================
+   int flags;
+   if(msgFlags == nullptr) {
+      flags    = 0;
+      msgFlags = &flags;
+   }
+   if(from) {
+      memset(from, 0, *fromSize);   // Clear address (Valgrind report)
+   }
+   sctp_sndrcvinfo sinfo;
+   const ssize_t   received =
+      sctp_recvmsg(socket->SocketDescriptor,
+                   (char*)&socket->MessageBuffer[socket->BytesRead], bytesToRead,
+                   from, fromSize, &sinfo, msgFlags);
+   if(received <= 0) {
+      return (received < 0) ? MRRM_SOCKET_ERROR : received;
+   }
+   if(streamID != nullptr) {
+      *streamID = (int64_t)sinfo.sinfo_stream;
+   }
+   socket->BytesRead += (size_t)received;
+
+   // ====== Handle message header ==========================================
+   if(socket->Status == Socket::MRS_WaitingForHeader) {
+      // ====== Handle SCTP notification header =============================
+      if(*msgFlags & MSG_NOTIFICATION) {
+#if defined(DEBUG_MESSAGEREADER)
+         printf("Socket %d:   notification L=%u\n",
+                socket->SocketDescriptor,
+                (unsigned int)sizeof(sctp_notification));
 #endif
-            }
-
-            // ====== Completed reading =====================================
-            if(socket->MessageSize > bufferSize) {
-               LOG_WARNING
-               stdlog << format("Buffer size is too small (buffer %u, message %u) for message from socket %d!",
-                                socket->SocketDescriptor,
-                                bufferSize, socket->MessageSize) << "\n";
-               LOG_END
-               socket->Status = Socket::MRS_StreamError;
-               return MRRM_STREAM_ERROR;
-            }
-            if((socket->Protocol == IPPROTO_SCTP) && (!(*msgFlags & MSG_EOR))) {
-               LOG_WARNING
-               stdlog << format("TLV message end does not match with SCTP message end in message from socket %d!",
-                                socket->SocketDescriptor) << "\n";
-               LOG_END
-               socket->Status = Socket::MRS_StreamError;
-               return MRRM_STREAM_ERROR;
-            }
-            received = (ssize_t)socket->MessageSize;
-            memcpy(buffer, socket->MessageBuffer, socket->MessageSize);
-            socket->Status      = Socket::MRS_WaitingForHeader;
-            socket->MessageSize = 0;
-            socket->BytesRead   = 0;
-            return received;
+         socket->MessageSize = sizeof(sctp_notification);   // maximum length
+         socket->Status      = Socket::MRS_PartialRead;
+         // SCTP notification has no TLV header, but must be handled like
+         // a message. The actual length of the notification is unknown, we
+         // need to look for MSG_EOF!
+      }
+      // ====== Handle TLV header ===========================================
+      else {
+         const ssize_t result = handleTLVHeader(socket);
+         if(result != 0) {
+            return result;
          }
-         return MRRM_BAD_SOCKET;
       }
+   }
 
-      // ====== Handle read errors ==========================================
-      else if(received < 0) {
-         return MRRM_SOCKET_ERROR;
+   // ====== Handle message payload =========================================
+   if(socket->Status == Socket::MRS_PartialRead) {
+      // ====== Partially read message ======================================
+      if(socket->BytesRead < socket->MessageSize) {
+         if(!(*msgFlags & MSG_EOR)) {
+            return MRRM_PARTIAL_READ;
+         }
+         // End of SCTP message:
+         if(!(*msgFlags & MSG_NOTIFICATION)) {   // data message
+            LOG_WARNING
+            stdlog << format("SCTP message end before TLV message end (read %u, expected %u) for message from socket %d!",
+                             (unsigned int)socket->BytesRead,
+                             (unsigned int)socket->MessageSize,
+                             socket->SocketDescriptor) << "\n";
+            LOG_END
+            socket->Status = Socket::MRS_StreamError;
+            return MRRM_STREAM_ERROR;
+         }
+         // This is the end of the SCTP notification. The message
+         // is complete here. Return it to the caller.
+         socket->MessageSize = socket->BytesRead;
       }
 
-      // ====== Shutdown ====================================================
-      else {   // received == 0
-         return received;
+      // ====== Completed reading ===========================================
+      if(!(*msgFlags & MSG_EOR)) {
+         LOG_WARNING
+         stdlog << format("TLV message end does not match with SCTP message end in message from socket %d!",
+                          socket->SocketDescriptor) << "\n";
+         LOG_END
+         socket->Status = Socket::MRS_StreamError;
+         return MRRM_STREAM_ERROR;
       }
+      return completeFramedMessage(socket, buffer, bufferSize);
    }
-
-   LOG_ERROR
-   stdlog << format("Invalid socket %d!", sd) << "\n";
-   LOG_END
    return MRRM_BAD_SOCKET;
 }
+#endif
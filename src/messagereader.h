@@ -30,6 +30,8 @@
 #ifndef MESSAGEREADER_H
 #define MESSAGEREADER_H
 
+#include "mutex.h"
+
 #include <cstddef>
 #include <ext_socket.h>
 #include <map>
@@ -41,11 +43,16 @@
 #define MRRM_PARTIAL_READ (ssize_t)-3
 #define MRRM_BAD_SOCKET   (ssize_t)-4
 
-class MessageReader
+// Size of the receive buffer for stream sockets in buffered mode:
+#define MESSAGE_READER_STREAM_BUFFER_SIZE (size_t)262144
+
+// NOTE: The MessageReader is locked by its methods, i.e. it may be used by
+//       multiple threads. It does not acquire any other lock.
+class MessageReader : public Mutex
 {
    // ====== Public Methods =================================================
    public:
-   MessageReader();
+   MessageReader(const size_t streamBufferSize = 0);
    ~MessageReader();
 
    bool registerSocket(const int    protocol,
@@ -61,10 +68,14 @@ class MessageReader
                           socklen_t*       fromSize = nullptr,
                           int64_t*         streamID = nullptr,
                           int*             msgFlags = nullptr);
+   bool hasBufferedMessage(const int sd);
    size_t getAllSDs(int* sds, const size_t maxEntries);
 
    inline size_t size() {
-      return SocketMap.size();
+      lock();
+      const size_t entries = SocketMap.size();
+      unlock();
+      return entries;
    }
 
    // ====== Private Data ===================================================
@@ -75,6 +86,15 @@ class MessageReader
       uint16_t Length;
    } __attribute__((packed));
 
+   struct Socket;
+   typedef ssize_t (MessageReader::*ReceiveFunction)(Socket*    socket,
+                                                     void*      buffer,
+                                                     size_t     bufferSize,
+                                                     sockaddr*  from,
+                                                     socklen_t* fromSize,
+                                                     int64_t*   streamID,
+                                                     int*       msgFlags);
+
    struct Socket {
       enum MessageReaderStatus {
          MRS_WaitingForHeader = 0,
@@ -89,8 +109,81 @@ class MessageReader
       size_t              MessageBufferSize;
       size_t              MessageSize;
       size_t              BytesRead;
+      ReceiveFunction     Receive;   // Protocol-specific receive function
+
+      // Buffered mode (TCP and MPTCP only):
+      char*               StreamBuffer;
+      size_t              StreamBufferStart;
+      size_t              StreamBufferEnd;
    };
 
+   ssize_t receiveSocketMessage(const int        sd,
+                                void*            buffer,
+                                size_t           bufferSize,
+                                sockaddr*        from,
+                                socklen_t*       fromSize,
+                                int64_t*         streamID,
+                                int*             msgFlags);
+   ssize_t receiveDatagramMessage(Socket*    socket,
+                                  void*      buffer,
+                                  size_t     bufferSize,
+                                  sockaddr*  from,
+                                  socklen_t* fromSize,
+                                  int64_t*   streamID,
+                                  int*       msgFlags);
+   ssize_t receiveBufferedMessage(Socket*    socket,
+                                  void*      buffer,
+                                  size_t     bufferSize,
+                                  sockaddr*  from,
+                                  socklen_t* fromSize,
+                                  int64_t*   streamID,
+                                  int*       msgFlags);
+   ssize_t receiveStreamMessage(Socket*    socket,
+                                void*      buffer,
+                                size_t     bufferSize,
+                                sockaddr*  from,
+                                socklen_t* fromSize,
+                                int64_t*   streamID,
+                                int*       msgFlags);
+   ssize_t receivePacketMessage(Socket*    socket,
+                                void*      buffer,
+                                size_t     bufferSize,
+                                sockaddr*  from,
+                                socklen_t* fromSize,
+                                int64_t*   streamID,
+                                int*       msgFlags);
+#if defined(HAVE_QUIC)
+   ssize_t receiveQUICMessage(Socket*    socket,
+                              void*      buffer,
+                              size_t     bufferSize,
+                              sockaddr*  from,
+                              socklen_t* fromSize,
+                              int64_t*   streamID,
+                              int*       msgFlags);
+#endif
+#if defined(HAVE_SCTP)
+   ssize_t receiveSCTPMessage(Socket*    socket,
+                              void*      buffer,
+                              size_t     bufferSize,
+                              sockaddr*  from,
+                              socklen_t* fromSize,
+                              int64_t*   streamID,
+                              int*       msgFlags);
+#endif
+   ssize_t getFramedBytesToRead(Socket* socket,
+                                size_t& bytesToRead);
+   ssize_t handleTLVHeader(Socket* socket);
+   ssize_t completeFramedMessage(Socket* socket,
+                                 void*   buffer,
+                                 size_t  bufferSize);
+   ssize_t handleFramedData(Socket*       socket,
+                            const ssize_t received,
+                            void*         buffer,
+                            size_t        bufferSize);
+   ssize_t extractBufferedMessage(Socket*    socket,
+                                  void*      buffer,
+                                  size_t     bufferSize);
+
    inline Socket* getSocket(const int sd) {
       std::map<int, Socket*>::iterator found = SocketMap.find(sd);
       if(found != SocketMap.end()) {
@@ -100,6 +193,7 @@ class MessageReader
    }
 
    std::map<int, Socket*> SocketMap;
+   size_t                 StreamBufferSize;
 };
 
 #endif
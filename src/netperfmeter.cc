@@ -43,6 +43,7 @@
 #include <iostream>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
+#include <netinet/udp.h>
 #include <poll.h>
 #include <signal.h>
 #include <unistd.h>
@@ -81,6 +82,11 @@ static bool             gBindV6Only            = false;
 static int              gSndBufSize            = -1;
 static int              gRcvBufSize            = -1;
 static int              gFlowCount             = 1;
+static int              gReceiverThreads       = 1;
+static int              gSenderThreads         = 0;
+static bool             gConnectedUDP          = false;
+static bool             gUseSeed               = false;
+static uint64_t         gSeed                  = 0;
 #if defined(HAVE_SCTP)
 static int              gActiveControlProtocol = IPPROTO_SCTP;
 static int              gPassiveControlSCTP    = true;
@@ -161,6 +167,10 @@ static MessageReader gMessageReader;
          "    [-K|--tls-key key_file] [-J|--tls-cert certificate_file] [-I|--tls-ca ca_certificate_file]\n"
          "    [-6|--v6only]\n"
          "    [--display|--nodisplay]\n"
+         "    [--receiver-threads threads]\n"
+         "    [--sender-threads threads|auto]\n"
+         "    [--connected-udp]\n"
+         "    [--seed seed]\n"
          "    [--loglevel level]\n"
          "    [--logcolor on|off]\n"
          "    [--logfile file]\n"
@@ -176,6 +186,9 @@ static MessageReader gMessageReader;
          "    [--display|--nodisplay]\n"
          "    [-o bytes|--sndbuf bytes]\n"
          "    [-i bytes|--rcvbuf bytes]\n"
+         "    [--receiver-threads threads]\n"
+         "    [--sender-threads threads|auto]\n"
+         "    [--seed seed]\n"
          "    [-T seconds|--runtime seconds]\n"
          "    [-C configuration_file_pattern|--config configuration_file_pattern]\n"
          "    [-S scalar_file_pattern|--scalar scalar_file_pattern]\n"
@@ -222,6 +235,10 @@ bool handleGlobalParameters(int argc, char** argv)
       { "sndbuf",                        required_argument, 0, 'o'    },
       { "rcvbuf",                        required_argument, 0, 'i'    },
       { "count",                         required_argument, 0, 'N'    },
+      { "receiver-threads",              required_argument, 0, 0x4000 },
+      { "sender-threads",                required_argument, 0, 0x4001 },
+      { "seed",                          required_argument, 0, 0x4002 },
+      { "connected-udp",                 no_argument,       0, 0x4004 },
       { "config",                        required_argument, 0, 'C'    },
       { "scalar",                        required_argument, 0, 'S'    },
       { "vector",                        required_argument, 0, 'V'    },
@@ -365,6 +382,33 @@ bool handleGlobalParameters(int argc, char** argv)
                exit(1);
             }
           break;
+         case 0x4000:
+            gReceiverThreads = atol(optarg);
+            if( (gReceiverThreads < 1) || (gReceiverThreads > 64) ) {
+               std::cerr << "ERROR: Invalid number of receiver threads " << gReceiverThreads << "!\n";
+               exit(1);
+            }
+          break;
+         case 0x4001:
+            if(strcmp(optarg, "auto") == 0) {
+               // One sender thread per core:
+               gSenderThreads = std::max(1L, sysconf(_SC_NPROCESSORS_ONLN));
+            }
+            else {
+               gSenderThreads = atol(optarg);
+            }
+            if( (gSenderThreads < 0) || (gSenderThreads > 1024) ) {
+               std::cerr << "ERROR: Invalid number of sender threads " << gSenderThreads << "!\n";
+               exit(1);
+            }
+          break;
+         case 0x4002:
+            gUseSeed = true;
+            gSeed    = strtoull(optarg, nullptr, 0);
+          break;
+         case 0x4004:
+            gConnectedUDP = true;
+          break;
          case 'T':
             gRuntime = atof(optarg);
           break;
@@ -554,7 +598,22 @@ void printGlobalParameters()
    stdlog << " - Minimum Logging Level     = " << gLogLevel << "\n"
           << " - Active Node Name          = " << gActiveNodeName  << "\n"
           << " - Passive Node Name         = " << gPassiveNodeName << "\n"
-          << " - Local Data Address(es)    = ";
+          << " - Receiver Threads          = " << gReceiverThreads << "\n"
+          << " - Sender Threads            = ";
+   if(gSenderThreads > 0) {
+      stdlog << gSenderThreads << "\n";
+   }
+   else {
+      stdlog << "one per flow\n";
+   }
+   stdlog << " - Random Seed               = ";
+   if(gUseSeed) {
+      stdlog << gSeed << "\n";
+   }
+   else {
+      stdlog << "none\n";
+   }
+   stdlog << " - Local Data Address(es)    = ";
    if(gLocalDataAddresses > 0) {
       for(unsigned int i = 0; i < gLocalDataAddresses; i++) {
          if(i > 0) {
@@ -584,15 +643,35 @@ void printGlobalParameters()
 
 
 // ###### Read random number parameter ######################################
-static const char* parseNextEntry(const char* parameters,
-                                  double*     valueArray,
-                                  uint8_t*    rng)
+// A trace file is only possible if traceFile is given (i.e. outbound only).
+static const char* parseNextEntry(const char*  parameters,
+                                  double*      valueArray,
+                                  uint8_t*     rng,
+                                  std::string* traceFile = nullptr)
 {
    int n = 0;
    for(size_t i = 0;i < NETPERFMETER_RNG_INPUT_PARAMETERS;i++) {
       valueArray[i] = 0.0;
    }
-   if(sscanf(parameters, "const%lf%n", &valueArray[0], &n) == 1) {
+   if(strncmp(parameters, "trace:", 6) == 0) {
+      if(traceFile == nullptr) {
+         std::cerr << "ERROR: Trace files are only supported for outgoing traffic: " << parameters << "!\n";
+         exit(1);
+      }
+      n = 6;
+      while( (parameters[n] != 0x00) && (parameters[n] != ':') ) {
+         n++;
+      }
+      *traceFile = std::string((const char*)&parameters[6], (size_t)n - 6);
+      TracePlayer tracePlayer;
+      if(!tracePlayer.open(*traceFile)) {
+         std::cerr << "ERROR: Unable to use trace file " << *traceFile << "!\n";
+         exit(1);
+      }
+      *rng          = RANDOM_TRACE;
+      valueArray[0] = 1.0;   // Non-zero -> neither saturated nor inactive
+   }
+   else if(sscanf(parameters, "const%lf%n", &valueArray[0], &n) == 1) {
       *rng = RANDOM_CONSTANT;
    }
    else if(sscanf(parameters, "uniform%lf,%lf%n", &valueArray[0], &valueArray[1], &n) == 2) {
@@ -831,6 +910,56 @@ static const char* parseTrafficSpecOption(const char*      parameters,
          exit(1);
       }
    }
+   else if(strncmp(parameters, "gso=", 4) == 0) {
+      if(strncmp((const char*)&parameters[4], "on", 2) == 0) {
+         trafficSpec.UseGSO = true;
+         n = 4 + 2;
+      }
+      else if(strncmp((const char*)&parameters[4], "off", 3) == 0) {
+         trafficSpec.UseGSO = false;
+         n = 4 + 3;
+      }
+      else {
+         std::cerr << "ERROR: Invalid \"gso\" setting: " << (const char*)&parameters[4] << "!\n";
+         exit(1);
+      }
+   }
+   else if(strncmp(parameters, "zerocopy=", 9) == 0) {
+      if(strncmp((const char*)&parameters[9], "on", 2) == 0) {
+         trafficSpec.UseZeroCopy = true;
+         n = 9 + 2;
+      }
+      else if(strncmp((const char*)&parameters[9], "off", 3) == 0) {
+         trafficSpec.UseZeroCopy = false;
+         n = 9 + 3;
+      }
+      else {
+         std::cerr << "ERROR: Invalid \"zerocopy\" setting: " << (const char*)&parameters[9] << "!\n";
+         exit(1);
+      }
+   }
+   else if(strncmp(parameters, "pacing=", 7) == 0) {
+      if(strncmp((const char*)&parameters[7], "default", 7) == 0) {
+         trafficSpec.Pacing = FlowTrafficSpec::DefaultPacing;
+         n = 7 + 7;
+      }
+      else if(strncmp((const char*)&parameters[7], "precise", 7) == 0) {
+         trafficSpec.Pacing = FlowTrafficSpec::PrecisePacing;
+         n = 7 + 7;
+      }
+      else if(strncmp((const char*)&parameters[7], "spin", 4) == 0) {
+         trafficSpec.Pacing = FlowTrafficSpec::SpinPacing;
+         n = 7 + 4;
+      }
+      else if(strncmp((const char*)&parameters[7], "kernel", 6) == 0) {
+         trafficSpec.Pacing = FlowTrafficSpec::KernelPacing;
+         n = 7 + 6;
+      }
+      else {
+         std::cerr << "ERROR: Invalid \"pacing\" setting: " << (const char*)&parameters[7] << "!\n";
+         exit(1);
+      }
+   }
    else if(strncmp(parameters, "debug=", 6) == 0) {
       if(strncmp((const char*)&parameters[6], "on", 2) == 0) {
          trafficSpec.Debug = true;
@@ -1077,9 +1206,11 @@ static Flow* createFlow(Flow*                  previousFlow,
       }
    }
    else {
-      parameters = parseNextEntry(parameters, (double*)&trafficSpec.OutboundFrameRate, &trafficSpec.OutboundFrameRateRng);
+      parameters = parseNextEntry(parameters, (double*)&trafficSpec.OutboundFrameRate, &trafficSpec.OutboundFrameRateRng,
+                                  &trafficSpec.OutboundFrameRateTrace);
       if(parameters) {
-         parameters = parseNextEntry(parameters, (double*)&trafficSpec.OutboundFrameSize, &trafficSpec.OutboundFrameSizeRng);
+         parameters = parseNextEntry(parameters, (double*)&trafficSpec.OutboundFrameSize, &trafficSpec.OutboundFrameSizeRng,
+                                     &trafficSpec.OutboundFrameSizeTrace);
          if(parameters) {
             parameters = parseNextEntry(parameters, (double*)&trafficSpec.InboundFrameRate, &trafficSpec.InboundFrameRateRng);
             if(parameters) {
@@ -1489,7 +1620,11 @@ static bool mainLoop(const bool               isActiveMode,
 #endif
       if( (udpID >= 0) && (fds[udpID].revents & (POLLIN|POLLERR)) ) {
          FlowManager::getFlowManager()->lock();
+#if defined(HAVE_RECVMMSG)
+         handleNetPerfMeterDataBatch(isActiveMode, now, gUDPSocket);
+#else
          handleNetPerfMeterData(isActiveMode, now, IPPROTO_UDP, gUDPSocket);
+#endif
          FlowManager::getFlowManager()->unlock();
       }
 #if defined(__OpenBSD__)
@@ -1804,13 +1939,25 @@ static void passiveMode(const uint16_t localPort)
                                     SOCK_DGRAM, IPPROTO_UDP, localPort,
                                     gLocalDataAddresses,
                                     (const sockaddr_union*)&gLocalDataAddressArray,
-                                    true, gBindV6Only);
+                                    true, gBindV6Only, gConnectedUDP);
    if(gUDPSocket < 0) {
       LOG_FATAL
       stdlog << "ERROR: Failed to create and bind UDP socket on port " << localPort << " - "
              << strerror(errno) << "!\n";
       LOG_END_FATAL
    }
+#if defined(HAVE_RECVMMSG) && defined(UDP_GRO)
+   // Coalesced datagrams are split into their segments by
+   // handleNetPerfMeterDataBatch(), using the segment size from the
+   // UDP_GRO control message.
+   const int groOn = 1;
+   if(ext_setsockopt(gUDPSocket, SOL_UDP, UDP_GRO, &groOn, sizeof(groOn)) < 0) {
+      LOG_DEBUG
+      stdlog << format("NOTE: Failed to enable GRO (UDP_GRO option) on UDP socket %d: %s!",
+                       gUDPSocket, strerror(errno)) << "\n";
+      LOG_END
+   }
+#endif
    // NOTE: For connection-less UDP, the FlowManager takes care of the socket!
    FlowManager::getFlowManager()->addUnidentifiedSocket(IPPROTO_UDP, gUDPSocket);
 #if defined(__OpenBSD__)
@@ -2302,6 +2449,18 @@ int main(int argc, char** argv)
           << "\n";
    LOG_END
 
+   // ====== Configure flow manager =========================================
+   if(!FlowManager::getFlowManager()->configureReceiverThreads((unsigned int)gReceiverThreads)) {
+      std::cerr << "ERROR: Unable to configure " << gReceiverThreads << " receiver threads!\n";
+      return 1;
+   }
+   if(!FlowManager::getFlowManager()->configureSenderThreads((unsigned int)gSenderThreads)) {
+      std::cerr << "ERROR: Unable to configure " << gSenderThreads << " sender threads!\n";
+      return 1;
+   }
+   FlowManager::getFlowManager()->configureConnectedUDP(gConnectedUDP);
+   FlowManager::getFlowManager()->configureRandomSeed(gUseSeed, gSeed);
+
    // ====== Run active or passive instance =================================
    if(inPassiveMode) {
       passiveMode(localPort);
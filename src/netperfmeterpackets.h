@@ -131,6 +131,11 @@ struct NetPerfMeterAddFlowMessage
 #define NPMAFF_DEBUG         (1 << 0)
 #define NPMAFF_NODELAY       (1 << 1)
 #define NPMAFF_REPEATONOFF   (1 << 2)
+#define NPMAFF_GSO           (1 << 3)
+#define NPMAFF_PRECISEPACING (1 << 4)
+#define NPMAFF_SPINPACING    (1 << 5)
+#define NPMAFF_KERNELPACING  (1 << 6)
+#define NPMAFF_ZEROCOPY      (1 << 7)
 
 // RetransmissionTrials in milliseconds (highest bit of 32-bit value set)
 #define NPMAF_RTX_TRIALS_IN_MILLISECONDS (1U << 31)    // Use ms instead of number of trials
@@ -0,0 +1,244 @@
+/*
+ * ==========================================================================
+ *         _   _      _   ____            __ __  __      _
+ *        | \ | | ___| |_|  _ \ ___ _ __ / _|  \/  | ___| |_ ___ _ __
+ *        |  \| |/ _ \ __| |_) / _ \ '__| |_| |\/| |/ _ \ __/ _ \ '__|
+ *        | |\  |  __/ |_|  __/  __/ |  |  _| |  | |  __/ ||  __/ |
+ *        |_| \_|\___|\__|_|   \___|_|  |_| |_|  |_|\___|\__\___|_|
+ *
+ *                  NetPerfMeter -- Network Performance Meter
+ *                 Copyright (C) 2009-2026 by Thomas Dreibholz
+ * ==========================================================================
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact:  dreibh@simula.no
+ * Homepage: https://www.nntb.no/~dreibh/netperfmeter/
+ */
+
+#include "receiverthread.h"
+#include "flowmanager.h"
+#include "loglevel.h"
+#include "tools.h"
+
+#include <poll.h>
+#include <signal.h>
+#if defined(HAVE_EPOLL)
+#include <sys/epoll.h>
+#endif
+
+#include <cstring>
+
+
+// #define DEBUG_POLL
+
+
+// Maximum number of events to handle per epoll_wait() call
+#define RECEIVERTHREAD_MAX_EPOLL_EVENTS 256
+
+// Timeout for waiting, in ms. It limits the delay for noticing the
+// thread stop, and -- without epoll -- for noticing newly added sockets.
+#define RECEIVERTHREAD_POLL_TIMEOUT 250
+
+
+// ###### Constructor #######################################################
+ReceiverThread::ReceiverThread(const unsigned int id)
+   : ID(id),
+     Reader(MESSAGE_READER_STREAM_BUFFER_SIZE)
+{
+#if defined(HAVE_EPOLL)
+   EPollFD = epoll_create1(EPOLL_CLOEXEC);
+   if(EPollFD < 0) {
+      LOG_FATAL
+      stdlog << format("Failed to create epoll instance: %s!",
+                       strerror(errno)) << "\n";
+      LOG_END_FATAL
+   }
+#endif
+}
+
+
+// ###### Destructor ########################################################
+ReceiverThread::~ReceiverThread()
+{
+   stop();
+   waitForFinish();
+   Sockets.clear();
+   Flows.clear();
+#if defined(HAVE_EPOLL)
+   ext_close(EPollFD);
+#endif
+}
+
+
+// ###### Add socket to poll set ############################################
+void ReceiverThread::addSocket(const int      socketDescriptor,
+                               const uint32_t sequenceNumber,
+                               const int      protocol)
+{
+   lock();
+   std::map<int, SocketEntry>::iterator found = Sockets.find(socketDescriptor);
+   if(found == Sockets.end()) {
+#if defined(HAVE_EPOLL)
+      epoll_event event;
+      memset(&event, 0, sizeof(event));
+      event.events   = EPOLLIN;
+      event.data.u64 = ((uint64_t)sequenceNumber << 32) | (uint32_t)socketDescriptor;
+      if(epoll_ctl(EPollFD, EPOLL_CTL_ADD, socketDescriptor, &event) < 0) {
+         LOG_ERROR
+         stdlog << format("Failed to add socket %d to epoll instance: %s!",
+                          socketDescriptor, strerror(errno)) << "\n";
+         LOG_END
+      }
+#endif
+      const SocketEntry entry = { sequenceNumber, protocol };
+      Sockets.insert(std::pair<int, SocketEntry>(socketDescriptor, entry));
+#if defined(DEBUG_POLL)
+      std::cerr << "poll-add: socket " << socketDescriptor
+                << " to receiver #" << ID << "\n";
+#endif
+   }
+   unlock();
+}
+
+
+// ###### Remove socket from poll set #######################################
+// NOTE: Since reading from a socket is done while the ReceiverThread is
+//       locked, the socket is not in use any more after this call.
+void ReceiverThread::removeSocket(const int socketDescriptor)
+{
+   lock();
+   std::map<int, SocketEntry>::iterator found = Sockets.find(socketDescriptor);
+   if(found != Sockets.end()) {
+#if defined(HAVE_EPOLL)
+      epoll_ctl(EPollFD, EPOLL_CTL_DEL, socketDescriptor, nullptr);
+#endif
+      Sockets.erase(found);
+#if defined(DEBUG_POLL)
+      std::cerr << "poll-remove: socket " << socketDescriptor
+                << " from receiver #" << ID << "\n";
+#endif
+   }
+   unlock();
+}
+
+
+// ###### Check whether socket registration is still valid ##################
+// NOTE: The ReceiverThread has to be locked by the caller!
+bool ReceiverThread::hasSocket(const int      socketDescriptor,
+                               const uint32_t sequenceNumber,
+                               int*           protocol)
+{
+   std::map<int, SocketEntry>::const_iterator found = Sockets.find(socketDescriptor);
+   if( (found != Sockets.end()) && (found->second.SequenceNumber == sequenceNumber) ) {
+      if(protocol != nullptr) {
+         *protocol = found->second.Protocol;
+      }
+      return true;
+   }
+   return false;
+}
+
+
+// ###### Set flow of socket and stream #####################################
+// The flow map mirrors the FlowManager's socket index. A flow removed here
+// is not in use by this ReceiverThread any more after this call.
+void ReceiverThread::setFlow(const int      socketDescriptor,
+                             const uint16_t streamID,
+                             Flow*          flow)
+{
+   lock();
+   if(flow != nullptr) {
+      Flows[getFlowKey(socketDescriptor, streamID)] = flow;
+   }
+   else {
+      Flows.erase(getFlowKey(socketDescriptor, streamID));
+   }
+   unlock();
+}
+
+
+// ###### Reception thread function #########################################
+void ReceiverThread::run()
+{
+   signal(SIGPIPE, SIG_IGN);
+
+   do {
+      // ====== Collect PollFDs for poll() ==================================
+#if !defined(HAVE_EPOLL)
+      // Without epoll, the poll() array is obtained from Sockets:
+      lock();
+      pollfd       pollFDs[Sockets.size()];
+      uint32_t     sequenceNumbers[Sockets.size()];
+      unsigned int n = 0;
+      for(std::map<int, SocketEntry>::const_iterator iterator = Sockets.begin();
+          iterator != Sockets.end(); iterator++) {
+         pollFDs[n].fd      = iterator->first;
+         pollFDs[n].events  = POLLIN;
+         pollFDs[n].revents = 0;
+         sequenceNumbers[n] = iterator->second.SequenceNumber;
+         n++;
+      }
+      unlock();
+#endif
+
+
+      // ====== Wait for events =============================================
+#if defined(HAVE_EPOLL)
+      epoll_event events[RECEIVERTHREAD_MAX_EPOLL_EVENTS];
+      const int result = epoll_wait(EPollFD, (epoll_event*)&events,
+                                    RECEIVERTHREAD_MAX_EPOLL_EVENTS,
+                                    RECEIVERTHREAD_POLL_TIMEOUT);
+#else
+      const int result = ext_poll_wrapper((pollfd*)&pollFDs, n,
+                                          RECEIVERTHREAD_POLL_TIMEOUT);
+#endif
+#if defined(DEBUG_POLL)
+      std::cerr << "receiver #" << ID << ": poll result=" << result << "\n";
+#endif
+
+
+      // ====== Handle events ===============================================
+      // The ready sockets are dispatched to the FlowManager, by socket
+      // descriptor. The ReceiverThread must not be locked here!
+      if(result > 0) {
+         const unsigned long long now = getMicroTime();
+#if defined(HAVE_EPOLL)
+         for(int i = 0; i < result; i++) {
+            const int      socketDescriptor = (int)(events[i].data.u64 & 0xffffffff);
+            const uint32_t sequenceNumber   = (uint32_t)(events[i].data.u64 >> 32);
+            if( ((events[i].events & (EPOLLIN|EPOLLHUP|EPOLLERR)) == EPOLLERR) &&
+                (FlowManager::getFlowManager()->handleSocketErrorEvent(socketDescriptor,
+                                                                       sequenceNumber)) ) {
+               continue;
+            }
+            FlowManager::getFlowManager()->handleSocketEvent(
+               this, now, socketDescriptor, sequenceNumber);
+         }
+#else
+         for(unsigned int i = 0; i < n; i++) {
+            if( ((pollFDs[i].revents & (POLLIN|POLLHUP|POLLERR)) == POLLERR) &&
+                (FlowManager::getFlowManager()->handleSocketErrorEvent(pollFDs[i].fd,
+                                                                       sequenceNumbers[i])) ) {
+               continue;
+            }
+            if(pollFDs[i].revents & (POLLIN|POLLERR)) {
+               FlowManager::getFlowManager()->handleSocketEvent(
+                  this, now, pollFDs[i].fd, sequenceNumbers[i]);
+            }
+         }
+#endif
+      }
+   } while(!isStopping());
+}
@@ -0,0 +1,112 @@
+/*
+ * ==========================================================================
+ *         _   _      _   ____            __ __  __      _
+ *        | \ | | ___| |_|  _ \ ___ _ __ / _|  \/  | ___| |_ ___ _ __
+ *        |  \| |/ _ \ __| |_) / _ \ '__| |_| |\/| |/ _ \ __/ _ \ '__|
+ *        | |\  |  __/ |_|  __/  __/ |  |  _| |  | |  __/ ||  __/ |
+ *        |_| \_|\___|\__|_|   \___|_|  |_| |_|  |_|\___|\__\___|_|
+ *
+ *                  NetPerfMeter -- Network Performance Meter
+ *                 Copyright (C) 2009-2026 by Thomas Dreibholz
+ * ==========================================================================
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact:  dreibh@simula.no
+ * Homepage: https://www.nntb.no/~dreibh/netperfmeter/
+ */
+
+#ifndef RECEIVERTHREAD_H
+#define RECEIVERTHREAD_H
+
+#include "thread.h"
+#include "messagereader.h"
+
+#include <map>
+#include <unordered_map>
+
+
+class Flow;
+
+// A ReceiverThread waits for input on its share of the FlowManager's
+// sockets. Each ReceiverThread has its own poll set and MessageReader.
+// Furthermore, it has its own map from socket and stream to the flows of
+// its sockets. So, data messages are handed to their flows without the
+// FlowManager's lock. The reception state of a flow (defragmenter and
+// reception statistics) is only updated while holding the lock of the
+// ReceiverThread of the flow's socket, i.e. by one thread at a time.
+class ReceiverThread : public Thread
+{
+   // ====== Methods ========================================================
+   public:
+   ReceiverThread(const unsigned int id);
+   virtual ~ReceiverThread();
+
+   inline unsigned int getID() const {
+      return ID;
+   }
+   inline MessageReader* getMessageReader() {
+      return &Reader;
+   }
+
+   void addSocket(const int      socketDescriptor,
+                  const uint32_t sequenceNumber,
+                  const int      protocol);
+   void removeSocket(const int socketDescriptor);
+   bool hasSocket(const int      socketDescriptor,
+                  const uint32_t sequenceNumber,
+                  int*           protocol = nullptr);
+   void setFlow(const int      socketDescriptor,
+                const uint16_t streamID,
+                Flow*          flow);
+
+   // NOTE: The ReceiverThread has to be locked by the caller!
+   inline Flow* findFlow(const int      socketDescriptor,
+                         const uint16_t streamID) const {
+      std::unordered_map<uint64_t, Flow*>::const_iterator found =
+         Flows.find(getFlowKey(socketDescriptor, streamID));
+      return (found != Flows.end()) ? found->second : nullptr;
+   }
+
+
+   // ====== Protected Methods ==============================================
+   protected:
+   void run();
+
+
+   // ====== Private Methods ================================================
+   private:
+   inline static uint64_t getFlowKey(const int      socketDescriptor,
+                                     const uint16_t streamID) {
+      return ((uint64_t)(uint32_t)socketDescriptor << 16) | streamID;
+   }
+
+
+   // ====== Private Data ===================================================
+   private:
+   struct SocketEntry {
+      uint32_t SequenceNumber;   // Registration in the FlowManager
+      int      Protocol;
+   };
+
+   const unsigned int                  ID;
+   MessageReader                       Reader;
+   std::map<int, SocketEntry>          Sockets;   // Sockets to wait for
+   std::unordered_map<uint64_t, Flow*> Flows;     // Flows of the sockets
+#if defined(HAVE_EPOLL)
+   int                                 EPollFD;
+#endif
+};
+
+#endif
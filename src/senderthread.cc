@@ -0,0 +1,245 @@
+/*
+ * ==========================================================================
+ *         _   _      _   ____            __ __  __      _
+ *        | \ | | ___| |_|  _ \ ___ _ __ / _|  \/  | ___| |_ ___ _ __
+ *        |  \| |/ _ \ __| |_) / _ \ '__| |_| |\/| |/ _ \ __/ _ \ '__|
+ *        | |\  |  __/ |_|  __/  __/ |  |  _| |  | |  __/ ||  __/ |
+ *        |_| \_|\___|\__|_|   \___|_|  |_| |_|  |_|\___|\__\___|_|
+ *
+ *                  NetPerfMeter -- Network Performance Meter
+ *                 Copyright (C) 2009-2026 by Thomas Dreibholz
+ * ==========================================================================
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact:  dreibh@simula.no
+ * Homepage: https://www.nntb.no/~dreibh/netperfmeter/
+ */
+
+#include "senderthread.h"
+#include "flow.h"
+#include "loglevel.h"
+#include "tools.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#if defined(HAVE_TIMERFD)
+#include <sys/timerfd.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+
+
+// ###### Constructor #######################################################
+SenderThread::SenderThread(const unsigned int id)
+   : ID(id),
+     Schedule(getMicroTime())
+{
+   CurrentFlow     = nullptr;
+   LatenessEvents  = 0;
+   LatenessSum     = 0;
+   LatenessMaximum = 0;
+   if(ext_pipe((int*)&WakeUpPipe) != 0) {
+      LOG_FATAL
+      stdlog << format("Failed to create wake-up pipe: %s!",
+                       strerror(errno)) << "\n";
+      LOG_END_FATAL
+   }
+   fcntl(WakeUpPipe[0], F_SETFL, O_NONBLOCK);
+   fcntl(WakeUpPipe[1], F_SETFL, O_NONBLOCK);
+#if defined(HAVE_TIMERFD)
+   // NOTE: getMicroTime() is based on CLOCK_REALTIME!
+   TimerFD = timerfd_create(CLOCK_REALTIME, TFD_NONBLOCK|TFD_CLOEXEC);
+   if(TimerFD < 0) {
+      LOG_FATAL
+      stdlog << format("Failed to create timerfd: %s!",
+                       strerror(errno)) << "\n";
+      LOG_END_FATAL
+   }
+#endif
+}
+
+
+// ###### Destructor ########################################################
+SenderThread::~SenderThread()
+{
+   stop();
+   wakeUp();
+   waitForFinish();
+   for(std::set<Flow*>::iterator iterator = Flows.begin();
+       iterator != Flows.end(); iterator++) {
+      Schedule.cancel(&(*iterator)->SenderTimer);
+   }
+#if defined(HAVE_TIMERFD)
+   ext_close(TimerFD);
+#endif
+   ext_close(WakeUpPipe[0]);
+   ext_close(WakeUpPipe[1]);
+}
+
+
+// ###### Wake up the thread ################################################
+void SenderThread::wakeUp()
+{
+   const char wakeUp = 0x00;
+   if(ext_write(WakeUpPipe[1], &wakeUp, sizeof(wakeUp)) < 0) {
+      // The pipe is full, i.e. the thread will wake up anyway.
+   }
+}
+
+
+// ###### Add flow ##########################################################
+void SenderThread::addFlow(Flow* flow, const unsigned long long nextEvent)
+{
+   lock();
+   Flows.insert(flow);
+   if(nextEvent != ~0ULL) {
+      // NOTE: An event in the past is due now. The lateness is measured
+      //       from the time of scheduling then.
+      Schedule.schedule(&flow->SenderTimer, std::max(nextEvent, getMicroTime()));
+   }
+   unlock();
+   wakeUp();
+}
+
+
+// ###### Remove flow #######################################################
+void SenderThread::removeFlow(Flow* flow, const bool waitForFlow)
+{
+   lock();
+   Flows.erase(flow);
+   Schedule.cancel(&flow->SenderTimer);
+   if(waitForFlow) {
+      // ====== Wait until the flow is not handled any more =================
+      while(CurrentFlow == flow) {
+         unlock();
+         delay(100);
+         lock();
+      }
+   }
+   unlock();
+}
+
+
+// ###### Get lateness statistics ###########################################
+void SenderThread::getLatenessStatistics(unsigned long long& events,
+                                         double&             averageLateness,
+                                         unsigned long long& maximumLateness)
+{
+   lock();
+   events          = LatenessEvents;
+   averageLateness = (LatenessEvents > 0) ? (double)LatenessSum / (double)LatenessEvents : 0.0;
+   maximumLateness = LatenessMaximum;
+   unlock();
+}
+
+
+// ###### Wait for next event ###############################################
+void SenderThread::waitForEvent(const unsigned long long now,
+                                const unsigned long long nextEvent)
+{
+   pollfd       pfd[2];
+   unsigned int n = 0;
+   pfd[n].fd      = WakeUpPipe[0];
+   pfd[n].events  = POLLIN;
+   pfd[n].revents = 0;
+   n++;
+#if defined(HAVE_TIMERFD)
+   // ====== Use timerfd for microsecond resolution =========================
+   if(nextEvent != ~0ULL) {
+      itimerspec timeout;
+      memset(&timeout, 0, sizeof(timeout));
+      timeout.it_value.tv_sec  = (time_t)(nextEvent / 1000000ULL);
+      timeout.it_value.tv_nsec = (long)((nextEvent % 1000000ULL) * 1000ULL);
+      if(timerfd_settime(TimerFD, TFD_TIMER_ABSTIME, &timeout, nullptr) == 0) {
+         pfd[n].fd      = TimerFD;
+         pfd[n].events  = POLLIN;
+         pfd[n].revents = 0;
+         n++;
+      }
+   }
+   const int timeout = (n > 1) ? pollTimeout(now, 1, now + 1000000) :
+                                 pollTimeout(now, 2, now + 1000000, nextEvent);
+#else
+   const int timeout = pollTimeout(now, 2, now + 1000000, nextEvent);
+#endif
+
+   // ====== Wait ===========================================================
+   if(ext_poll_wrapper((pollfd*)&pfd, n, timeout) > 0) {
+      if(pfd[0].revents & POLLIN) {
+         char buffer[64];
+         while(ext_read(WakeUpPipe[0], (char*)&buffer, sizeof(buffer)) > 0) { }
+      }
+#if defined(HAVE_TIMERFD)
+      if( (n > 1) && (pfd[1].revents & POLLIN) ) {
+         uint64_t expirations;
+         if(ext_read(TimerFD, (char*)&expirations, sizeof(expirations)) < 0) {
+            // Already read -> nothing to do here.
+         }
+      }
+#endif
+   }
+}
+
+
+// ###### Sender thread function ############################################
+void SenderThread::run()
+{
+   signal(SIGPIPE, SIG_IGN);
+
+   do {
+      // ====== Get next due flow ===========================================
+      lock();
+      const unsigned long long now   = getMicroTime();
+      TimerWheel::Timer*       timer = Schedule.expire(now);
+
+      // ====== Handle flow's events ========================================
+      if(timer != nullptr) {
+         Flow* flow = (Flow*)timer->Data;
+         const unsigned long long lateness = now - timer->Deadline;
+         LatenessEvents++;
+         LatenessSum += lateness;
+         if(lateness > LatenessMaximum) {
+            LatenessMaximum = lateness;
+         }
+         CurrentFlow = flow;
+         unlock();
+
+         const bool               result    = flow->handleNextEvent(now);
+         const unsigned long long nextEvent = flow->scheduleNextEvent();
+
+         lock();
+         CurrentFlow = nullptr;
+         if(Flows.find(flow) != Flows.end()) {
+            if(!result) {
+               // The flow's transmission has failed -> stop handling it.
+               Flows.erase(flow);
+            }
+            else if(nextEvent != ~0ULL) {
+               Schedule.schedule(&flow->SenderTimer, std::max(nextEvent, getMicroTime()));
+            }
+         }
+         unlock();
+      }
+
+      // ====== Wait until there is something to do =========================
+      else {
+         const unsigned long long nextEvent = Schedule.getNextEvent();
+         unlock();
+         waitForEvent(now, nextEvent);
+      }
+   } while(!isStopping());
+}
@@ -0,0 +1,97 @@
+/*
+ * ==========================================================================
+ *         _   _      _   ____            __ __  __      _
+ *        | \ | | ___| |_|  _ \ ___ _ __ / _|  \/  | ___| |_ ___ _ __
+ *        |  \| |/ _ \ __| |_) / _ \ '__| |_| |\/| |/ _ \ __/ _ \ '__|
+ *        | |\  |  __/ |_|  __/  __/ |  |  _| |  | |  __/ ||  __/ |
+ *        |_| \_|\___|\__|_|   \___|_|  |_| |_|  |_|\___|\__\___|_|
+ *
+ *                  NetPerfMeter -- Network Performance Meter
+ *                 Copyright (C) 2009-2026 by Thomas Dreibholz
+ * ==========================================================================
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact:  dreibh@simula.no
+ * Homepage: https://www.nntb.no/~dreibh/netperfmeter/
+ */
+
+#ifndef SENDERTHREAD_H
+#define SENDERTHREAD_H
+
+#include "thread.h"
+#include "timerwheel.h"
+
+#include <set>
+
+
+class Flow;
+
+// A SenderThread multiplexes the transmissions of multiple flows. The next
+// transmission or status change events of its flows are scheduled in a
+// hierarchical timing wheel.
+class SenderThread : public Thread
+{
+   // ====== Methods ========================================================
+   public:
+   SenderThread(const unsigned int id);
+   virtual ~SenderThread();
+
+   inline unsigned int getID() const {
+      return ID;
+   }
+   inline size_t getFlows() {
+      lock();
+      const size_t flows = Flows.size();
+      unlock();
+      return flows;
+   }
+
+   void addFlow(Flow* flow, const unsigned long long nextEvent);
+   void removeFlow(Flow* flow, const bool waitForFlow);
+   void getLatenessStatistics(unsigned long long& events,
+                              double&             averageLateness,
+                              unsigned long long& maximumLateness);
+
+
+   // ====== Protected Methods ==============================================
+   protected:
+   void run();
+
+
+   // ====== Private Methods ================================================
+   private:
+   void wakeUp();
+   void waitForEvent(const unsigned long long now,
+                     const unsigned long long nextEvent);
+
+
+   // ====== Private Data ===================================================
+   private:
+   const unsigned int ID;
+   std::set<Flow*>    Flows;
+   TimerWheel         Schedule;
+   Flow*              CurrentFlow;   // Flow currently handled
+   int                WakeUpPipe[2];
+#if defined(HAVE_TIMERFD)
+   int                TimerFD;
+#endif
+
+   // ------ Lateness of handled events, in us ------------------------------
+   unsigned long long LatenessEvents;
+   unsigned long long LatenessSum;
+   unsigned long long LatenessMaximum;
+};
+
+#endif
@@ -0,0 +1,265 @@
+/*
+ * ==========================================================================
+ *         _   _      _   ____            __ __  __      _
+ *        | \ | | ___| |_|  _ \ ___ _ __ / _|  \/  | ___| |_ ___ _ __
+ *        |  \| |/ _ \ __| |_) / _ \ '__| |_| |\/| |/ _ \ __/ _ \ '__|
+ *        | |\  |  __/ |_|  __/  __/ |  |  _| |  | |  __/ ||  __/ |
+ *        |_| \_|\___|\__|_|   \___|_|  |_| |_|  |_|\___|\__\___|_|
+ *
+ *                  NetPerfMeter -- Network Performance Meter
+ *                 Copyright (C) 2009-2026 by Thomas Dreibholz
+ * ==========================================================================
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact:  dreibh@simula.no
+ * Homepage: https://www.nntb.no/~dreibh/netperfmeter/
+ */
+
+#include "timerwheel.h"
+#include "assure.h"
+
+#include <cstring>
+
+
+// ###### Constructor #######################################################
+TimerWheel::TimerWheel(const unsigned long long now)
+{
+   Current  = now;
+   Timers   = 0;
+   Expired  = nullptr;
+   Overflow = nullptr;
+   memset(&Slots, 0, sizeof(Slots));
+   memset(&Occupied, 0, sizeof(Occupied));
+}
+
+
+// ###### Destructor ########################################################
+TimerWheel::~TimerWheel()
+{
+   assure(Timers == 0);
+}
+
+
+// ###### Initialise timer ##################################################
+void TimerWheel::initTimer(Timer* timer, void* data)
+{
+   timer->Deadline = 0;
+   timer->Data     = data;
+   timer->Previous = nullptr;
+   timer->Next     = nullptr;
+   timer->List     = nullptr;
+   timer->Level    = TIMERWHEEL_LEVELS;
+   timer->Slot     = 0;
+}
+
+
+// ###### Schedule timer ####################################################
+void TimerWheel::schedule(Timer* timer, const unsigned long long deadline)
+{
+   if(isScheduled(timer)) {
+      unlink(timer);
+      Timers--;
+   }
+   timer->Deadline = deadline;
+   insert(timer);
+   Timers++;
+}
+
+
+// ###### Cancel timer ######################################################
+void TimerWheel::cancel(Timer* timer)
+{
+   if(isScheduled(timer)) {
+      unlink(timer);
+      Timers--;
+   }
+}
+
+
+// ###### Get next expired timer ############################################
+// Returns nullptr if there is no expired timer.
+TimerWheel::Timer* TimerWheel::expire(const unsigned long long now)
+{
+   advance(now);
+   Timer* timer = Expired;
+   if(timer != nullptr) {
+      unlink(timer);
+      Timers--;
+   }
+   return timer;
+}
+
+
+// ###### Get time of next event ############################################
+// The next event is the earliest deadline on the lowest level, or the time
+// when the next timers have to be cascaded to a lower level.
+unsigned long long TimerWheel::getNextEvent()
+{
+   if(Expired != nullptr) {
+      return Current;
+   }
+
+   unsigned long long nextEvent = ~0ULL;
+   for(unsigned int level = 0; level < TIMERWHEEL_LEVELS; level++) {
+      const int slot = findSlot(level, getSlot(Current, level) + 1);
+      if(slot >= 0) {
+         const unsigned int       shift = (level + 1) * TIMERWHEEL_SLOT_BITS;
+         const unsigned long long event = ((Current >> shift) << shift) |
+                                          ((unsigned long long)slot << (level * TIMERWHEEL_SLOT_BITS));
+         if(event < nextEvent) {
+            nextEvent = event;
+         }
+      }
+   }
+   if(Overflow != nullptr) {
+      const unsigned int       shift = TIMERWHEEL_LEVELS * TIMERWHEEL_SLOT_BITS;
+      const unsigned long long event = ((Current >> shift) + 1) << shift;
+      if(event < nextEvent) {
+         nextEvent = event;
+      }
+   }
+   return nextEvent;
+}
+
+
+// ###### Insert timer into wheel ###########################################
+// The level is given by the most significant slot bits differing between
+// deadline and current time.
+void TimerWheel::insert(Timer* timer)
+{
+   if(timer->Deadline <= Current) {
+      timer->Level = TIMERWHEEL_LEVELS;
+      link(&Expired, timer);
+      return;
+   }
+
+   const unsigned long long difference = timer->Deadline ^ Current;
+   for(unsigned int level = 0; level < TIMERWHEEL_LEVELS; level++) {
+      if((difference >> ((level + 1) * TIMERWHEEL_SLOT_BITS)) == 0) {
+         const unsigned int slot = getSlot(timer->Deadline, level);
+         timer->Level = level;
+         timer->Slot  = slot;
+         link(&Slots[level][slot], timer);
+         Occupied[level][slot / 64] |= (1ULL << (slot % 64));
+         return;
+      }
+   }
+   timer->Level = TIMERWHEEL_LEVELS;
+   link(&Overflow, timer);
+}
+
+
+// ###### Link timer into list ##############################################
+void TimerWheel::link(Timer** list, Timer* timer)
+{
+   timer->List     = list;
+   timer->Previous = nullptr;
+   timer->Next     = *list;
+   if(*list != nullptr) {
+      (*list)->Previous = timer;
+   }
+   *list = timer;
+}
+
+
+// ###### Unlink timer from its list ########################################
+void TimerWheel::unlink(Timer* timer)
+{
+   if(timer->Previous != nullptr) {
+      timer->Previous->Next = timer->Next;
+   }
+   else {
+      *timer->List = timer->Next;
+   }
+   if(timer->Next != nullptr) {
+      timer->Next->Previous = timer->Previous;
+   }
+   if( (timer->Level < TIMERWHEEL_LEVELS) && (*timer->List == nullptr) ) {
+      Occupied[timer->Level][timer->Slot / 64] &= ~(1ULL << (timer->Slot % 64));
+   }
+   timer->List     = nullptr;
+   timer->Previous = nullptr;
+   timer->Next     = nullptr;
+}
+
+
+// ###### Re-insert all timers of a list, relative to current time #########
+void TimerWheel::cascade(Timer** list)
+{
+   // NOTE: Timers of the overflow list may be re-inserted into this list.
+   //       Therefore, the list is detached first.
+   Timer* timer = *list;
+   *list = nullptr;
+   if( (timer != nullptr) && (timer->Level < TIMERWHEEL_LEVELS) ) {
+      Occupied[timer->Level][timer->Slot / 64] &= ~(1ULL << (timer->Slot % 64));
+   }
+   while(timer != nullptr) {
+      Timer* next = timer->Next;
+      timer->List     = nullptr;
+      timer->Previous = nullptr;
+      timer->Next     = nullptr;
+      insert(timer);
+      timer = next;
+   }
+}
+
+
+// ###### Advance current time ##############################################
+// Empty slots are skipped, i.e. the wheel jumps from event to event.
+void TimerWheel::advance(const unsigned long long now)
+{
+   while(Current < now) {
+      // ====== Find next event =============================================
+      Timer* expired = Expired;
+      Expired = nullptr;
+      const unsigned long long nextEvent = getNextEvent();
+      Expired = expired;
+      if(nextEvent > now) {
+         // No timer is passed until now -> just update the current time.
+         Current = now;
+         break;
+      }
+      Current = nextEvent;
+
+      // ====== Cascade timers ==============================================
+      // Higher levels first, since their timers may fall into the slots
+      // of the lower levels beginning now.
+      if((Current & ((1ULL << (TIMERWHEEL_LEVELS * TIMERWHEEL_SLOT_BITS)) - 1)) == 0) {
+         cascade(&Overflow);
+      }
+      for(int level = TIMERWHEEL_LEVELS - 1; level >= 0; level--) {
+         if((Current & ((1ULL << (level * TIMERWHEEL_SLOT_BITS)) - 1)) == 0) {
+            cascade(&Slots[level][getSlot(Current, (unsigned int)level)]);
+         }
+      }
+   }
+}
+
+
+// ###### Find first occupied slot, beginning at given slot #################
+// Returns -1 if there is no such slot.
+int TimerWheel::findSlot(const unsigned int level, const unsigned int from) const
+{
+   for(unsigned int word = from / 64; word < TIMERWHEEL_SLOT_WORDS; word++) {
+      uint64_t bits = Occupied[level][word];
+      if(word == from / 64) {
+         bits &= (~0ULL << (from % 64));
+      }
+      if(bits != 0) {
+         return (int)(word * 64 + (unsigned int)__builtin_ctzll(bits));
+      }
+   }
+   return -1;
+}
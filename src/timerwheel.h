@@ -0,0 +1,110 @@
+/*
+ * ==========================================================================
+ *         _   _      _   ____            __ __  __      _
+ *        | \ | | ___| |_|  _ \ ___ _ __ / _|  \/  | ___| |_ ___ _ __
+ *        |  \| |/ _ \ __| |_) / _ \ '__| |_| |\/| |/ _ \ __/ _ \ '__|
+ *        | |\  |  __/ |_|  __/  __/ |  |  _| |  | |  __/ ||  __/ |
+ *        |_| \_|\___|\__|_|   \___|_|  |_| |_|  |_|\___|\__\___|_|
+ *
+ *                  NetPerfMeter -- Network Performance Meter
+ *                 Copyright (C) 2009-2026 by Thomas Dreibholz
+ * ==========================================================================
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact:  dreibh@simula.no
+ * Homepage: https://www.nntb.no/~dreibh/netperfmeter/
+ */
+
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include <cstddef>
+#include <cstdint>
+
+
+// Hierarchical timing wheel with microsecond slots. Level l has
+// TIMERWHEEL_SLOTS slots of TIMERWHEEL_SLOTS^l microseconds each, i.e. the
+// levels cover 256 us, 65.5 ms, 16.8 s and 71.6 min. Timers beyond are kept
+// in an overflow list. Scheduling and cancelling a timer is O(1); expiring
+// is O(1) amortised, since a timer is cascaded at most once per level.
+#define TIMERWHEEL_LEVELS     4
+#define TIMERWHEEL_SLOT_BITS  8
+#define TIMERWHEEL_SLOTS      (1 << TIMERWHEEL_SLOT_BITS)
+#define TIMERWHEEL_SLOT_WORDS (TIMERWHEEL_SLOTS / 64)
+
+class TimerWheel
+{
+   // ====== Timer ==========================================================
+   public:
+   struct Timer {
+      unsigned long long Deadline;
+      void*              Data;
+
+      // Internal usage only:
+      Timer*             Previous;
+      Timer*             Next;
+      Timer**            List;
+      unsigned int       Level;
+      unsigned int       Slot;
+   };
+
+   // ====== Methods ========================================================
+   public:
+   TimerWheel(const unsigned long long now);
+   ~TimerWheel();
+
+   static void initTimer(Timer* timer, void* data);
+   inline static bool isScheduled(const Timer* timer) {
+      return timer->List != nullptr;
+   }
+   inline bool isEmpty() const {
+      return Timers == 0;
+   }
+   inline size_t getTimers() const {
+      return Timers;
+   }
+
+   void schedule(Timer* timer, const unsigned long long deadline);
+   void cancel(Timer* timer);
+   Timer* expire(const unsigned long long now);
+   unsigned long long getNextEvent();
+
+
+   // ====== Private Methods ================================================
+   private:
+   void insert(Timer* timer);
+   void link(Timer** list, Timer* timer);
+   void unlink(Timer* timer);
+   void cascade(Timer** list);
+   void advance(const unsigned long long now);
+   int findSlot(const unsigned int level, const unsigned int from) const;
+
+   inline static unsigned int getSlot(const unsigned long long time,
+                                      const unsigned int       level) {
+      return (unsigned int)(time >> (level * TIMERWHEEL_SLOT_BITS)) & (TIMERWHEEL_SLOTS - 1);
+   }
+
+
+   // ====== Private Data ===================================================
+   private:
+   unsigned long long Current;    // Time up to which the wheel is processed
+   size_t             Timers;
+   Timer*             Expired;    // Timers with Deadline <= Current
+   Timer*             Overflow;   // Timers beyond the highest level
+   Timer*             Slots[TIMERWHEEL_LEVELS][TIMERWHEEL_SLOTS];
+   uint64_t           Occupied[TIMERWHEEL_LEVELS][TIMERWHEEL_SLOT_WORDS];
+};
+
+#endif
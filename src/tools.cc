@@ -31,6 +31,7 @@
 
 #include <arpa/inet.h>
 #include <cassert>
+#include <cerrno>
 #include <cmath>
 #include <cstdarg>
 #include <cstdio>
@@ -113,6 +114,34 @@ int pollTimeout(const unsigned long long now, const size_t n, ...)
 }
 
 
+// ###### Wait until given absolute microtime ##############################
+// Sleeps until spinTime before wakeUpTime, then busy-waits for the rest.
+void waitUntil(const unsigned long long wakeUpTime,
+               const unsigned long long spinTime)
+{
+   const unsigned long long sleepUntil = wakeUpTime - std::min(wakeUpTime, spinTime);
+   unsigned long long       now        = getMicroTime();
+
+   // ====== Sleep ==========================================================
+   if(sleepUntil > now) {
+#if defined(HAVE_CLOCK_NANOSLEEP)
+      timespec ts;
+      ts.tv_sec  = (time_t)(sleepUntil / 1000000ULL);
+      ts.tv_nsec = (long)((sleepUntil % 1000000ULL) * 1000ULL);
+      while(clock_nanosleep(CLOCK_REALTIME, TIMER_ABSTIME, &ts, nullptr) == EINTR) { }
+#else
+      usleep((useconds_t)(sleepUntil - now));
+#endif
+      now = getMicroTime();
+   }
+
+   // ====== Spin ===========================================================
+   while(now < wakeUpTime) {
+      now = getMicroTime();
+   }
+}
+
+
 // ###### Length-checking strcpy() #########################################
 int safestrcpy(char* dest, const char* src, const size_t size)
 {
@@ -987,7 +1016,8 @@ void sendBreak(const bool quiet)
 
 
 // ###### Get random value using specified random number generator ##########
-double getRandomValue(const double* valueArray, const uint8_t rng)
+double getRandomValue(const double* valueArray, const uint8_t rng,
+                      FastRandom* generator)
 {
    double value;
    switch(rng) {
@@ -995,19 +1025,19 @@ double getRandomValue(const double* valueArray, const uint8_t rng)
          value = valueArray[0];
        break;
       case RANDOM_UNIFORM:
-         value = valueArray[0] + (randomDouble() * (valueArray[1] - valueArray[0]));
+         value = valueArray[0] + (randomDouble(generator) * (valueArray[1] - valueArray[0]));
        break;
       case RANDOM_EXPONENTIAL:
-         value = randomExpDouble(valueArray[0]);
+         value = randomExpDouble(valueArray[0], generator);
        break;
       case RANDOM_PARETO:
-         value = randomParetoDouble(valueArray[0], valueArray[1]);
+         value = randomParetoDouble(valueArray[0], valueArray[1], generator);
        break;
       case RANDOM_NORMAL:
-         value = randomNormal(valueArray[0], valueArray[1]);
+         value = randomNormal(valueArray[0], valueArray[1], generator);
        break;
       case RANDOM_TRUNCATED_NORMAL:
-         value = randomTruncNormal(valueArray[0], valueArray[1]);
+         value = randomTruncNormal(valueArray[0], valueArray[1], generator);
        break;
       default:
          abort();
@@ -1017,6 +1047,122 @@ double getRandomValue(const double* valueArray, const uint8_t rng)
 }
 
 
+// ###### Fill array with uniform random values #############################
+// Resulting range: (0, 1), i.e. suitable for log() and pow().
+static void getUniformValues(double* values, const size_t count,
+                             FastRandom* generator)
+{
+   for(size_t i = 0;i < count;i++) {
+      values[i] = ((double)(fastRandom64(generator) >> 11) + 0.5) *
+                     (1.0 / (double)(1ULL << 53));
+   }
+}
+
+
+// ###### Fill array with normal-distributed random values ##################
+// Box-Muller transform, using both of its outputs.
+static void getNormalValues(double* values, const size_t count,
+                            const double mean, const double stddev,
+                            FastRandom* generator)
+{
+   double u[RANDOM_VALUE_BUFFER_SIZE];
+   double v[RANDOM_VALUE_BUFFER_SIZE];
+   size_t i = 0;
+   while(i < count) {
+      const size_t pairs = std::min((count - i + 1) / 2, (size_t)RANDOM_VALUE_BUFFER_SIZE);
+      getUniformValues(u, pairs, generator);
+      getUniformValues(v, pairs, generator);
+      for(size_t j = 0;j < pairs;j++) {
+         const double r = stddev * sqrt(-2.0 * log(u[j]));
+         u[j] = mean + r * cos(M_PI * 2.0 * v[j]);
+         v[j] = mean + r * sin(M_PI * 2.0 * v[j]);
+      }
+      for(size_t j = 0;(j < pairs) && (i < count);j++) {
+         values[i++] = u[j];
+         if(i < count) {
+            values[i++] = v[j];
+         }
+      }
+   }
+}
+
+
+// ###### Fill array with random values of given random number generator ####
+// The values are generated block-wise: first the uniform values, then one
+// transformation loop per distribution. Unlike calling getRandomValue()
+// for each value, this needs no per-value switch and the loops are
+// suitable for vectorised math libraries.
+void getRandomValues(double*       values,
+                     const size_t  count,
+                     const double* valueArray,
+                     const uint8_t rng,
+                     FastRandom*   generator)
+{
+   switch(rng) {
+      case RANDOM_CONSTANT:
+         for(size_t i = 0;i < count;i++) {
+            values[i] = valueArray[0];
+         }
+       break;
+      case RANDOM_UNIFORM: {
+            const double lower = valueArray[0];
+            const double range = valueArray[1] - valueArray[0];
+            getUniformValues(values, count, generator);
+            for(size_t i = 0;i < count;i++) {
+               values[i] = lower + values[i] * range;
+            }
+         }
+       break;
+      case RANDOM_EXPONENTIAL: {
+            const double mean = valueArray[0];
+            getUniformValues(values, count, generator);
+            for(size_t i = 0;i < count;i++) {
+               values[i] = -mean * log(values[i]);
+            }
+         }
+       break;
+      case RANDOM_PARETO: {
+            // location / r^(1/shape) = location * exp(-log(r) / shape)
+            const double location = valueArray[0];
+            const double exponent = -1.0 / valueArray[1];
+            assert(valueArray[1] > 0.0);
+            getUniformValues(values, count, generator);
+            for(size_t i = 0;i < count;i++) {
+               values[i] = location * exp(log(values[i]) * exponent);
+            }
+         }
+       break;
+      case RANDOM_NORMAL:
+         getNormalValues(values, count, valueArray[0], valueArray[1], generator);
+       break;
+      case RANDOM_TRUNCATED_NORMAL: {
+            double normalValues[RANDOM_VALUE_BUFFER_SIZE];
+            size_t i = 0;
+            while(i < count) {
+               const size_t n = std::min(count - i, (size_t)RANDOM_VALUE_BUFFER_SIZE);
+               getNormalValues(normalValues, n, valueArray[0], valueArray[1], generator);
+               for(size_t j = 0;j < n;j++) {
+                  if(normalValues[j] >= 0.0) {
+                     values[i++] = normalValues[j];
+                  }
+               }
+            }
+         }
+       break;
+      default:
+         abort();
+       break;
+   }
+}
+
+
+// ###### Initialise random value buffer ####################################
+void initRandomValueBuffer(RandomValueBuffer* buffer)
+{
+   buffer->Position = RANDOM_VALUE_BUFFER_SIZE;   // Empty -> fill on first use
+}
+
+
 // ###### Get name of specified random number generator #####################
 const char* getRandomGeneratorName(const uint8_t rng)
 {
@@ -1029,6 +1175,12 @@ const char* getRandomGeneratorName(const uint8_t rng)
          return "exponential";
       case RANDOM_PARETO:
          return "pareto";
+      case RANDOM_NORMAL:
+         return "normal";
+      case RANDOM_TRUNCATED_NORMAL:
+         return "truncnormal";
+      case RANDOM_TRACE:
+         return "trace";
    }
    return "(invalid!)";
 }
@@ -1109,38 +1261,115 @@ uint32_t random32()
 }
 
 
+/*
+   The traffic models sample random values per frame or message, from all
+   flow threads. Reading these from /dev/urandom would need a locked stdio
+   call, and frequently a system call, for each value. Therefore, these
+   values are taken from xoshiro256** generators: either the generator
+   given by the caller (e.g. the deterministic stream of a flow), or the
+   thread's own generator, which is seeded once from random64(). IDs (like
+   the measurement ID) are still obtained from random64().
+*/
+
+static thread_local FastRandom ThreadRandom;
+static thread_local bool       ThreadRandomSeeded = false;
+
+
+// ###### Rotate 64-bit value left ##########################################
+static inline uint64_t rotateLeft(const uint64_t x, const int k)
+{
+   return (x << k) | (x >> (64 - k));
+}
+
+
+// ###### Mix bits of 64-bit value (SplitMix64 finalizer) ###################
+uint64_t mixBits64(uint64_t z)
+{
+   z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+   z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+   return z ^ (z >> 31);
+}
+
+
+// ###### Seed fast random number generator #################################
+void seedFastRandom(uint64_t seed, FastRandom* generator)
+{
+   if(generator == nullptr) {
+      generator          = &ThreadRandom;
+      ThreadRandomSeeded = true;
+   }
+   // Expand seed by SplitMix64, which never leads to an all-zero state:
+   for(unsigned int i = 0;i < 4;i++) {
+      seed += 0x9e3779b97f4a7c15ULL;
+      generator->State[i] = mixBits64(seed);
+   }
+}
+
+
+// ###### Get 64-bit random value from fast generator #######################
+uint64_t fastRandom64(FastRandom* generator)
+{
+   if(generator == nullptr) {
+      if(__builtin_expect(!ThreadRandomSeeded, 0)) {
+         seedFastRandom(random64());
+      }
+      generator = &ThreadRandom;
+   }
+
+   // xoshiro256** by David Blackman and Sebastiano Vigna
+   // (https://prng.di.unimi.it/xoshiro256starstar.c):
+   uint64_t*      state  = generator->State;
+   const uint64_t result = rotateLeft(state[1] * 5, 7) * 9;
+   const uint64_t t      = state[1] << 17;
+   state[2] ^= state[0];
+   state[3] ^= state[1];
+   state[1] ^= state[2];
+   state[0] ^= state[3];
+   state[2] ^= t;
+   state[3] = rotateLeft(state[3], 45);
+   return result;
+}
+
+
 // ###### Get double random value ###########################################
-double randomDouble()
+double randomDouble(FastRandom* generator)
 {
    // Resulting range: [0, 1)
+#if defined(SIM_IMPORT) || defined(OMNETPPLIBS_IMPORT)
    return (double)random32() / (double)0x100000000;
+#else
+   // Using the upper 53 bits as mantissa:
+   return (double)(fastRandom64(generator) >> 11) * (1.0 / (double)(1ULL << 53));
+#endif
 }
 
 
 // ###### Get exponential-distributed double random value ###################
-double randomExpDouble(const double mean)
+double randomExpDouble(const double mean, FastRandom* generator)
 {
    // randomDouble() returns value in [0, 1), i.e. 0 is included. log(0) = -∞.
    // => Using 1.0 - randomDouble() to prevent this issue:
-   return -mean * log(1.0 - randomDouble());
+   return -mean * log(1.0 - randomDouble(generator));
 }
 
 
 // ###### Get normal-distributed double random value ########################
-double randomNormal(const double mean, const double stddev)
+double randomNormal(const double mean, const double stddev,
+                    FastRandom* generator)
 {
-    const double u = randomDouble();
-    const double v = randomDouble();
+    const double u = randomDouble(generator);
+    const double v = randomDouble(generator);
     return mean + stddev * sqrt(-2.0*log(u)) * cos(M_PI*2.0*v);
 }
 
 
 // ###### Get truncated-normal-distributed double random value ##############
-double randomTruncNormal(const double mean, const double stddev)
+double randomTruncNormal(const double mean, const double stddev,
+                         FastRandom* generator)
 {
    double result;
    do {
-       result = randomNormal(mean, stddev);
+       result = randomNormal(mean, stddev, generator);
    } while(result < 0);
    return result;
 }
@@ -1167,13 +1396,14 @@ double randomTruncNormal(const double mean, const double stddev)
 // Mean: E(X) = shape*location / (shape - 1) for alpha > 1
 // => location = E(X)*(shape - 1) / shape
 //
-double randomParetoDouble(const double location, const double shape)
+double randomParetoDouble(const double location, const double shape,
+                          FastRandom* generator)
 {
    assert(shape > 0.0);
 
-   double r = randomDouble();
+   double r = randomDouble(generator);
    while ((r <= 0.0) || (r >= 1.0)) {
-      r = randomDouble();
+      r = randomDouble(generator);
    }
    return location / pow(r, 1.0 / shape);
 }
@@ -96,6 +96,8 @@ std::string format(const char* fmt, ...);
 unsigned long long getMicroTime();
 void printTimeStamp(std::ostream& os);
 int pollTimeout(const unsigned long long now, const size_t n, ...);
+void waitUntil(const unsigned long long wakeUpTime,
+               const unsigned long long spinTime = 0);
 
 
 int safestrcpy(char* dest, const char* src, const size_t size);
@@ -170,18 +172,63 @@ void sendBreak(const bool quiet);
 #define RANDOM_PARETO           3
 #define RANDOM_NORMAL           4
 #define RANDOM_TRUNCATED_NORMAL 5
+#define RANDOM_TRACE            6   // Replay of trace file (outbound only)
 
+// State of a xoshiro256** generator
+struct FastRandom
+{
+   uint64_t State[4];
+};
+
+// Block of precomputed random values of one distribution
+#define RANDOM_VALUE_BUFFER_SIZE 64
+struct RandomValueBuffer
+{
+   size_t Position;
+   double Values[RANDOM_VALUE_BUFFER_SIZE];
+};
+
+// Functions with FastRandom* parameter: nullptr uses the thread's generator.
 const char* getRandomGeneratorName(const uint8_t rng);
-double getRandomValue(const double* valueArray, const uint8_t rng);
+double getRandomValue(const double* valueArray, const uint8_t rng,
+                      FastRandom* generator = nullptr);
+void getRandomValues(double* values, const size_t count,
+                     const double* valueArray, const uint8_t rng,
+                     FastRandom* generator = nullptr);
+void initRandomValueBuffer(RandomValueBuffer* buffer);
+
+// ###### Get next random value from buffer, refill if necessary ############
+inline double getBufferedRandomValue(RandomValueBuffer* buffer,
+                                     const double*      valueArray,
+                                     const uint8_t      rng,
+                                     FastRandom*        generator = nullptr)
+{
+   if(rng == RANDOM_CONSTANT) {
+      return valueArray[0];
+   }
+   if(__builtin_expect(buffer->Position >= RANDOM_VALUE_BUFFER_SIZE, 0)) {
+      getRandomValues(buffer->Values, RANDOM_VALUE_BUFFER_SIZE,
+                      valueArray, rng, generator);
+      buffer->Position = 0;
+   }
+   return buffer->Values[buffer->Position++];
+}
+
 uint8_t random8();
 uint16_t random16();
 uint64_t random64();
 uint32_t random32();
-double randomDouble();
-double randomExpDouble(const double mean);
-double randomNormal(const double mean, const double stddev);
-double randomTruncNormal(const double mean, const double stddev);
-double randomParetoDouble(const double location, const double shape);
+uint64_t mixBits64(uint64_t z);
+void seedFastRandom(uint64_t seed, FastRandom* generator = nullptr);
+uint64_t fastRandom64(FastRandom* generator = nullptr);
+double randomDouble(FastRandom* generator = nullptr);
+double randomExpDouble(const double mean, FastRandom* generator = nullptr);
+double randomNormal(const double mean, const double stddev,
+                    FastRandom* generator = nullptr);
+double randomTruncNormal(const double mean, const double stddev,
+                         FastRandom* generator = nullptr);
+double randomParetoDouble(const double location, const double shape,
+                          FastRandom* generator = nullptr);
 
 #if defined(__APPLE__)
 // Apple's poll() function is broken. We need a wrapper to select() here!
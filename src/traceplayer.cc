@@ -0,0 +1,169 @@
+/*
+ * ==========================================================================
+ *         _   _      _   ____            __ __  __      _
+ *        | \ | | ___| |_|  _ \ ___ _ __ / _|  \/  | ___| |_ ___ _ __
+ *        |  \| |/ _ \ __| |_) / _ \ '__| |_| |\/| |/ _ \ __/ _ \ '__|
+ *        | |\  |  __/ |_|  __/  __/ |  |  _| |  | |  __/ ||  __/ |
+ *        |_| \_|\___|\__|_|   \___|_|  |_| |_|  |_|\___|\__\___|_|
+ *
+ *                  NetPerfMeter -- Network Performance Meter
+ *                 Copyright (C) 2009-2026 by Thomas Dreibholz
+ * ==========================================================================
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact:  dreibh@simula.no
+ * Homepage: https://www.nntb.no/~dreibh/netperfmeter/
+ */
+
+#include "traceplayer.h"
+#include "loglevel.h"
+#include "tools.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+// Replayed pages are released in chunks of this size
+#define TRACEPLAYER_RELEASE_CHUNK_SIZE (size_t)(16 * 1024 * 1024)
+
+
+// ###### Constructor #######################################################
+TracePlayer::TracePlayer()
+{
+   Records       = nullptr;
+   RecordCount   = 0;
+   Position      = 0;
+   MappingSize   = 0;
+   ReleasedBytes = 0;
+}
+
+
+// ###### Destructor ########################################################
+TracePlayer::~TracePlayer()
+{
+   close();
+}
+
+
+// ###### Open trace file ###################################################
+bool TracePlayer::open(const std::string& fileName)
+{
+   close();
+
+   // ====== Open file ======================================================
+   const int fd = ::open(fileName.c_str(), O_RDONLY);
+   if(fd < 0) {
+      LOG_ERROR
+      stdlog << format("Unable to open trace file %s: %s!",
+                       fileName.c_str(), strerror(errno)) << "\n";
+      LOG_END
+      return false;
+   }
+   struct stat status;
+   if( (fstat(fd, &status) != 0) ||
+       ((size_t)status.st_size < sizeof(NetPerfMeterTraceRecord)) ) {
+      LOG_ERROR
+      stdlog << format("Trace file %s contains no records!",
+                       fileName.c_str()) << "\n";
+      LOG_END
+      ::close(fd);
+      return false;
+   }
+
+   // ====== Map file =======================================================
+   MappingSize = (size_t)status.st_size;
+   void* mapping = mmap(nullptr, MappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+   ::close(fd);   // The mapping remains valid.
+   if(mapping == MAP_FAILED) {
+      LOG_ERROR
+      stdlog << format("Unable to map trace file %s: %s!",
+                       fileName.c_str(), strerror(errno)) << "\n";
+      LOG_END
+      MappingSize = 0;
+      return false;
+   }
+   posix_madvise(mapping, MappingSize, POSIX_MADV_SEQUENTIAL);
+
+   Records       = (const NetPerfMeterTraceRecord*)mapping;
+   RecordCount   = MappingSize / sizeof(NetPerfMeterTraceRecord);
+   Position      = 0;
+   ReleasedBytes = 0;
+   return true;
+}
+
+
+// ###### Close trace file ##################################################
+void TracePlayer::close()
+{
+   if(Records != nullptr) {
+      munmap((void*)Records, MappingSize);
+      Records     = nullptr;
+      RecordCount = 0;
+      MappingSize = 0;
+   }
+}
+
+
+// ###### Get next record ###################################################
+const NetPerfMeterTraceRecord* TracePlayer::nextRecord()
+{
+   if(Records == nullptr) {
+      return nullptr;
+   }
+
+   // ====== Release replayed pages =========================================
+   const size_t offset = Position * sizeof(NetPerfMeterTraceRecord);
+   if(offset - ReleasedBytes >= TRACEPLAYER_RELEASE_CHUNK_SIZE) {
+      // The mapping is page-aligned and the chunk size is a multiple of
+      // the page size, so the released range is page-aligned as well.
+      posix_madvise((char*)Records + ReleasedBytes,
+                    TRACEPLAYER_RELEASE_CHUNK_SIZE, POSIX_MADV_DONTNEED);
+      ReleasedBytes += TRACEPLAYER_RELEASE_CHUNK_SIZE;
+   }
+
+   // ====== Get record, restart at end of trace ============================
+   const NetPerfMeterTraceRecord* record = &Records[Position];
+   Position++;
+   if(Position >= RecordCount) {
+      Position      = 0;
+      ReleasedBytes = 0;
+   }
+   return record;
+}
+
+
+// ###### Get next inter-arrival time (in us) ###############################
+unsigned long long TracePlayer::nextInterArrivalTime()
+{
+   const NetPerfMeterTraceRecord* record = nextRecord();
+   if(record == nullptr) {
+      return 1000000;   // No trace -> just do not busy-loop
+   }
+   return le32toh(record->InterArrivalTime);
+}
+
+
+// ###### Get next frame size (in bytes) ####################################
+double TracePlayer::nextFrameSize()
+{
+   const NetPerfMeterTraceRecord* record = nextRecord();
+   if(record == nullptr) {
+      return 0.0;
+   }
+   return (double)le32toh(record->FrameSize);
+}
@@ -0,0 +1,77 @@
+/*
+ * ==========================================================================
+ *         _   _      _   ____            __ __  __      _
+ *        | \ | | ___| |_|  _ \ ___ _ __ / _|  \/  | ___| |_ ___ _ __
+ *        |  \| |/ _ \ __| |_) / _ \ '__| |_| |\/| |/ _ \ __/ _ \ '__|
+ *        | |\  |  __/ |_|  __/  __/ |  |  _| |  | |  __/ ||  __/ |
+ *        |_| \_|\___|\__|_|   \___|_|  |_| |_|  |_|\___|\__\___|_|
+ *
+ *                  NetPerfMeter -- Network Performance Meter
+ *                 Copyright (C) 2009-2026 by Thomas Dreibholz
+ * ==========================================================================
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact:  dreibh@simula.no
+ * Homepage: https://www.nntb.no/~dreibh/netperfmeter/
+ */
+
+#ifndef TRACEPLAYER_H
+#define TRACEPLAYER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+
+// Record of a binary traffic trace file (all values in little endian)
+struct NetPerfMeterTraceRecord
+{
+   uint32_t InterArrivalTime;   // Time since previous frame (in us)
+   uint32_t FrameSize;          // Frame size (in bytes)
+} __attribute__((packed));
+
+
+// Replay of a binary traffic trace file. The file is memory-mapped, not
+// read: pages are loaded on demand while the replay advances, and the
+// pages already replayed are released again. So, also traces much larger
+// than the main memory can be replayed. At the end of the trace, the
+// replay restarts from its beginning.
+class TracePlayer
+{
+   // ====== Methods ========================================================
+   public:
+   TracePlayer();
+   ~TracePlayer();
+
+   bool open(const std::string& fileName);
+   void close();
+
+   unsigned long long nextInterArrivalTime();
+   double nextFrameSize();
+
+   // ====== Private Methods ================================================
+   private:
+   const NetPerfMeterTraceRecord* nextRecord();
+
+   // ====== Private Data ===================================================
+   private:
+   const NetPerfMeterTraceRecord* Records;
+   size_t                         RecordCount;
+   size_t                         Position;
+   size_t                         MappingSize;
+   size_t                         ReleasedBytes;
+};
+
+#endif
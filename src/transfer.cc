@@ -32,13 +32,26 @@
 #include "tools.h"
 
 #include <cstring>
+#if defined(__linux__)
+#include <linux/net_tstamp.h>
+#endif
+#include <netinet/udp.h>
 
 
 #define MAXIMUM_MESSAGE_SIZE (size_t)65536
 #define MAXIMUM_PAYLOAD_SIZE (MAXIMUM_MESSAGE_SIZE - sizeof(NetPerfMeterDataMessage))
 
+#define UDP_BATCH_MAX_MESSAGES 64
+#define UDP_BATCH_MAX_SEGMENTS 512
+#define UDP_GSO_MAX_SEGMENTS   64
+#define UDP_GSO_MAX_SIZE       (size_t)65000
+#define UDP_GSO_DEFAULT_MTU    (size_t)1500
+#define UDP_BATCH_CONTROL_SIZE (CMSG_SPACE(sizeof(uint16_t)) + CMSG_SPACE(sizeof(uint64_t)))
+#define UDP_RECEIVE_BATCH_SIZE 32
+
 
-static void updateStatistics(Flow*                          flowSpec,
+static void updateStatistics(ReceiverThread*                receiverThread,
+                             Flow*                          flowSpec,
                              const unsigned long long       now,
                              const NetPerfMeterDataMessage* dataMsg,
                              const size_t                   received);
@@ -73,127 +86,624 @@ static void fillPayload(unsigned char* payload,
 }
 
 
-// ###### Send NETPERFMETER_DATA message ####################################
-ssize_t sendNetPerfMeterData(Flow*                    flow,
-                             const uint32_t           frameID,
-                             const bool               isFrameBegin,
-                             const bool               isFrameEnd,
-                             const unsigned long long now,
-                             size_t                   bytesToSend)
+// ====== Payload templates =================================================
+// The payload pattern only depends on the direction of the transfer. It is
+// therefore generated once, and each message just references the payload
+// template (or copies it, where scatter-gather I/O is not applicable).
+struct PayloadTemplate
+{
+   PayloadTemplate() {
+      fillPayload((unsigned char*)&Forward, sizeof(Forward), false);
+      fillPayload((unsigned char*)&Reverse, sizeof(Reverse), true);
+   }
+
+   alignas(4096) unsigned char Forward[MAXIMUM_PAYLOAD_SIZE];
+   alignas(4096) unsigned char Reverse[MAXIMUM_PAYLOAD_SIZE];
+};
+
+static const PayloadTemplate gPayloadTemplate;
+
+
+// ###### Get payload template for flow #####################################
+inline static const unsigned char* getPayloadTemplate(Flow* flow)
 {
-   char                     outputBuffer[MAXIMUM_MESSAGE_SIZE];
-   NetPerfMeterDataMessage* dataMsg = (NetPerfMeterDataMessage*)&outputBuffer;
+   return (flow->isAcceptedIncomingFlow()) ? gPayloadTemplate.Reverse :
+                                             gPayloadTemplate.Forward;
+}
+
 
+// ###### Prepare NETPERFMETER_DATA message header ##########################
+// Only the header is written; the payload is given by the payload template.
+// The return value is the size of the whole message.
+static size_t prepareNetPerfMeterData(Flow*                    flow,
+                                      NetPerfMeterDataMessage* dataMsg,
+                                      const uint32_t           frameID,
+                                      const bool               isFrameBegin,
+                                      const bool               isFrameEnd,
+                                      const unsigned long long now,
+                                      size_t                   bytesToSend)
+{
    if(bytesToSend < sizeof(NetPerfMeterDataMessage)) {
       bytesToSend = sizeof(NetPerfMeterDataMessage);
    }
-
-   // ====== Prepare NETPERFMETER_DATA message ==============================
-   // ------ Create header --------------------------------
-   dataMsg->Header.Type   = NETPERFMETER_DATA;
-   dataMsg->Header.Flags  = 0x00;
-   if(isFrameBegin) {
-      dataMsg->Header.Flags |= NPMDF_FRAME_BEGIN;
-   }
-   if(isFrameEnd) {
-      dataMsg->Header.Flags |= NPMDF_FRAME_END;
+   else if(bytesToSend > MAXIMUM_MESSAGE_SIZE) {
+      bytesToSend = MAXIMUM_MESSAGE_SIZE;
    }
+
+   // ====== Create header ==================================================
+   // Copy the flow's pre-serialised header template, then patch the
+   // per-message fields only.
+   *dataMsg = flow->getDataHeaderTemplate();
+   dataMsg->Header.Flags  = (isFrameBegin ? NPMDF_FRAME_BEGIN : 0x00) |
+                            (isFrameEnd   ? NPMDF_FRAME_END   : 0x00);
    dataMsg->Header.Length = htobe16(bytesToSend);
-   dataMsg->MeasurementID = htobe64(flow->getMeasurementID());
-   dataMsg->FlowID        = htobe32(flow->getFlowID());
-   dataMsg->StreamID      = htobe16(flow->getStreamID());
-   dataMsg->Padding       = 0x0000;
    dataMsg->FrameID       = htobe32(frameID);
    dataMsg->SeqNumber     = htobe64(flow->nextOutboundSeqNumber());
-   dataMsg->ByteSeqNumber = htobe64(flow->getCurrentBandwidthStats().TransmittedBytes);
+   dataMsg->ByteSeqNumber = htobe64(flow->getTransmittedBytes());
    dataMsg->TimeStamp     = htobe64(now);
 
-   // ------ Create payload data pattern ------------------
-   fillPayload((unsigned char*)&dataMsg->Payload,
-               bytesToSend - sizeof(NetPerfMeterDataMessage),
-               flow->isAcceptedIncomingFlow());
+   return bytesToSend;
+}
+
+
+#if defined(HAVE_SCTP) || defined(HAVE_QUIC)
+// ###### Copy NETPERFMETER_DATA message into contiguous buffer #############
+static void copyNetPerfMeterData(char*                          outputBuffer,
+                                 const NetPerfMeterDataMessage* dataMsg,
+                                 const unsigned char*           payload,
+                                 const size_t                   payloadLength)
+{
+   memcpy(outputBuffer, dataMsg, sizeof(NetPerfMeterDataMessage));
+   memcpy(&outputBuffer[sizeof(NetPerfMeterDataMessage)], payload, payloadLength);
+}
+#endif
+
+
+// ###### Check, whether flow has been aborted unintentionally ##############
+static void checkForAbortedFlow(Flow* flow, const ssize_t sent)
+{
+   if( (sent < 0) &&
+       (errno != EAGAIN) &&
+       (!flow->isAcceptedIncomingFlow()) &&
+       (flow->getTrafficSpec().ErrorOnAbort) &&
+       (flow->getOutputStatus() == Flow::On) ) {
+      LOG_FATAL
+      stdlog << format("Flow #%u on socket %d has been aborted: %s!",
+                       flow->getFlowID(), flow->getSocketDescriptor(),
+                       strerror(errno)) << "\n";
+      LOG_END_FATAL
+   }
+}
+
 
-   // ====== Send NETPERFMETER_DATA message =================================
-   ssize_t sent;
-   if(0) { /* Dummy for following "else if" in #if ... #endif block */ }
 #if defined(HAVE_SCTP)
-   else if(flow->getTrafficSpec().Protocol == IPPROTO_SCTP) {
-      sctp_sndrcvinfo sinfo;
-      memset(&sinfo, 0, sizeof(sinfo));
-      sinfo.sinfo_stream   = flow->getStreamID();
-      sinfo.sinfo_ppid     = htobe32(PPID_NETPERFMETER_DATA);
-      if(flow->getTrafficSpec().ReliableMode < 1.0) {
-         const bool sendUnreliable = (randomDouble() > flow->getTrafficSpec().ReliableMode);
-         if(sendUnreliable) {
-            sinfo.sinfo_timetolive = flow->getTrafficSpec().RetransmissionTrials;
-            if(flow->getTrafficSpec().RetransmissionTrialsInMS) {
-               sinfo.sinfo_flags |= SCTP_PR_SCTP_TTL;
-            }
-            else {
+// ###### Send NETPERFMETER_DATA message over SCTP ##########################
+static ssize_t sendNetPerfMeterDataSCTP(Flow*                    flow,
+                                        const uint32_t           frameID,
+                                        const bool               isFrameBegin,
+                                        const bool               isFrameEnd,
+                                        const unsigned long long now,
+                                        size_t                   bytesToSend)
+{
+   NetPerfMeterDataMessage dataMsg;
+   char                    outputBuffer[MAXIMUM_MESSAGE_SIZE];
+
+   // ====== Prepare NETPERFMETER_DATA message ==============================
+   bytesToSend = prepareNetPerfMeterData(flow, &dataMsg, frameID,
+                                         isFrameBegin, isFrameEnd,
+                                         now, bytesToSend);
+   copyNetPerfMeterData((char*)&outputBuffer, &dataMsg, getPayloadTemplate(flow),
+                        bytesToSend - sizeof(NetPerfMeterDataMessage));
+
+   // ====== Send NETPERFMETER_DATA message =================================
+   sctp_sndrcvinfo sinfo;
+   memset(&sinfo, 0, sizeof(sinfo));
+   sinfo.sinfo_stream   = flow->getStreamID();
+   sinfo.sinfo_ppid     = htobe32(PPID_NETPERFMETER_DATA);
+   if(flow->getTrafficSpec().ReliableMode < 1.0) {
+      const bool sendUnreliable = (randomDouble(flow->getRandomStream()) > flow->getTrafficSpec().ReliableMode);
+      if(sendUnreliable) {
+         sinfo.sinfo_timetolive = flow->getTrafficSpec().RetransmissionTrials;
+         if(flow->getTrafficSpec().RetransmissionTrialsInMS) {
+            sinfo.sinfo_flags |= SCTP_PR_SCTP_TTL;
+         }
+         else {
 #if defined(SCTP_PR_SCTP_RTX)
-               sinfo.sinfo_flags |= SCTP_PR_SCTP_RTX;
+            sinfo.sinfo_flags |= SCTP_PR_SCTP_RTX;
 #else
 #warning SCTP option SCTP_PR_SCTP_RTX is not supported by the API of this system!
 #endif
-            }
          }
       }
-      if(flow->getTrafficSpec().OrderedMode < 1.0) {
-         const bool sendUnordered = (randomDouble() > flow->getTrafficSpec().OrderedMode);
-         if(sendUnordered) {
-            sinfo.sinfo_flags |= SCTP_UNORDERED;
-         }
+   }
+   if(flow->getTrafficSpec().OrderedMode < 1.0) {
+      const bool sendUnordered = (randomDouble(flow->getRandomStream()) > flow->getTrafficSpec().OrderedMode);
+      if(sendUnordered) {
+         sinfo.sinfo_flags |= SCTP_UNORDERED;
       }
-      sent = sctp_send(flow->getSocketDescriptor(),
-                       (char*)&outputBuffer, bytesToSend,
-                       &sinfo, 0);
    }
+   return sctp_send(flow->getSocketDescriptor(),
+                    (char*)&outputBuffer, bytesToSend,
+                    &sinfo, 0);
+}
 #endif
+
+
 #if defined(HAVE_QUIC)
-   else if(flow->getTrafficSpec().Protocol == IPPROTO_QUIC) {
-      int64_t  sid;
-      uint32_t flags;
-      if(flow->isAcceptedIncomingFlow()) {   // from passive side (server)
-         sid   = ((int64_t)flow->getStreamID() << 2) | QUIC_STREAM_TYPE_SERVER_MASK | QUIC_STREAM_TYPE_UNI_MASK;
-         flags = (flow->getFirstTransmission() == 0) ? MSG_QUIC_STREAM_NEW : 0;
+// ###### Send NETPERFMETER_DATA message over QUIC ##########################
+static ssize_t sendNetPerfMeterDataQUIC(Flow*                    flow,
+                                        const uint32_t           frameID,
+                                        const bool               isFrameBegin,
+                                        const bool               isFrameEnd,
+                                        const unsigned long long now,
+                                        size_t                   bytesToSend)
+{
+   NetPerfMeterDataMessage dataMsg;
+   char                    outputBuffer[MAXIMUM_MESSAGE_SIZE];
+
+   // ====== Prepare NETPERFMETER_DATA message ==============================
+   bytesToSend = prepareNetPerfMeterData(flow, &dataMsg, frameID,
+                                         isFrameBegin, isFrameEnd,
+                                         now, bytesToSend);
+   copyNetPerfMeterData((char*)&outputBuffer, &dataMsg, getPayloadTemplate(flow),
+                        bytesToSend - sizeof(NetPerfMeterDataMessage));
+
+   // ====== Send NETPERFMETER_DATA message =================================
+   int64_t  sid;
+   uint32_t flags;
+   if(flow->isAcceptedIncomingFlow()) {   // from passive side (server)
+      sid   = ((int64_t)flow->getStreamID() << 2) | QUIC_STREAM_TYPE_SERVER_MASK | QUIC_STREAM_TYPE_UNI_MASK;
+      flags = (flow->getFirstTransmission() == 0) ? MSG_QUIC_STREAM_NEW : 0;
+   }
+   else {
+      sid   = ((int64_t)flow->getStreamID() << 2) | QUIC_STREAM_TYPE_UNI_MASK;
+      flags = 0;   // already created by Identify procedure!
+   }
+   return quic_sendmsg(flow->getSocketDescriptor(), (char*)&outputBuffer, bytesToSend, sid, flags);
+}
+#endif
+
+
+// ###### Send header and payload template by scatter-gather I/O ############
+static inline ssize_t sendNetPerfMeterDataMessage(Flow*                          flow,
+                                                  const NetPerfMeterDataMessage* dataMsg,
+                                                  const size_t                   bytesToSend,
+                                                  const sockaddr*                to,
+                                                  const int                      flags)
+{
+   struct iovec iov[2];
+   iov[0].iov_base = (void*)dataMsg;
+   iov[0].iov_len  = sizeof(NetPerfMeterDataMessage);
+   iov[1].iov_base = (void*)getPayloadTemplate(flow);
+   iov[1].iov_len  = bytesToSend - sizeof(NetPerfMeterDataMessage);
+
+   struct msghdr msg;
+   memset(&msg, 0, sizeof(msg));
+   msg.msg_iov    = (struct iovec*)&iov;
+   msg.msg_iovlen = (iov[1].iov_len > 0) ? 2 : 1;
+   if(to != nullptr) {
+      msg.msg_name    = (void*)to;
+      msg.msg_namelen = getSocklen(to);
+   }
+   return ext_sendmsg(flow->getSocketDescriptor(), &msg, flags);
+}
+
+
+// ###### Send NETPERFMETER_DATA message (TCP, MPTCP, DCCP) #################
+static ssize_t sendNetPerfMeterData(Flow*                    flow,
+                                    const uint32_t           frameID,
+                                    const bool               isFrameBegin,
+                                    const bool               isFrameEnd,
+                                    const unsigned long long now,
+                                    size_t                   bytesToSend)
+{
+   NetPerfMeterDataMessage dataMsg;
+   bytesToSend = prepareNetPerfMeterData(flow, &dataMsg, frameID,
+                                         isFrameBegin, isFrameEnd,
+                                         now, bytesToSend);
+   return sendNetPerfMeterDataMessage(flow, &dataMsg, bytesToSend, nullptr, 0);
+}
+
+
+// ###### Send NETPERFMETER_DATA message over UDP ###########################
+static ssize_t sendNetPerfMeterDataUDP(Flow*                    flow,
+                                       const uint32_t           frameID,
+                                       const bool               isFrameBegin,
+                                       const bool               isFrameEnd,
+                                       const unsigned long long now,
+                                       size_t                   bytesToSend)
+{
+   NetPerfMeterDataMessage dataMsg;
+   bytesToSend = prepareNetPerfMeterData(flow, &dataMsg, frameID,
+                                         isFrameBegin, isFrameEnd,
+                                         now, bytesToSend);
+   // The passive side's UDP socket is unconnected:
+   return sendNetPerfMeterDataMessage(flow, &dataMsg, bytesToSend,
+                                      (flow->isRemoteAddressValid()) ? flow->getRemoteAddress() : nullptr,
+                                      0);
+}
+
+
+#if defined(MSG_ZEROCOPY)
+// ###### Send NETPERFMETER_DATA message by MSG_ZEROCOPY (TCP) ##############
+static ssize_t sendNetPerfMeterDataZeroCopy(Flow*                    flow,
+                                            const uint32_t           frameID,
+                                            const bool               isFrameBegin,
+                                            const bool               isFrameEnd,
+                                            const unsigned long long now,
+                                            size_t                   bytesToSend)
+{
+   // ====== Use header of zero-copy ring ===================================
+   NetPerfMeterDataMessage* dataMsg = flow->getZeroCopyHeader();
+   if(dataMsg == nullptr) {
+      errno = EAGAIN;   // Flow is stopping
+      return -1;
+   }
+   bytesToSend = prepareNetPerfMeterData(flow, dataMsg, frameID,
+                                         isFrameBegin, isFrameEnd,
+                                         now, bytesToSend);
+
+   // ====== Send NETPERFMETER_DATA message =================================
+   ssize_t sent = sendNetPerfMeterDataMessage(flow, dataMsg, bytesToSend, nullptr, MSG_ZEROCOPY);
+   if(sent > 0) {
+      flow->commitZeroCopyHeader();
+   }
+   else if( (sent < 0) && (errno == ENOBUFS) ) {
+      // No memory for the completion notification -> copy instead.
+      sent = sendNetPerfMeterDataMessage(flow, dataMsg, bytesToSend, nullptr, 0);
+   }
+   return sent;
+}
+#endif
+
+
+// ###### Transmit data frame message by message ############################
+static void transmitFrameByMessages(Flow*                    flow,
+                                    const uint32_t           frameID,
+                                    const unsigned long long now,
+                                    const ssize_t            bytesToSend,
+                                    ssize_t&                 bytesSent,
+                                    size_t&                  packetsSent)
+{
+   const MessageTransmitter sendMessage  = flow->getMessageTransmitter();
+   const ssize_t            maxChunkSize = std::min((ssize_t)flow->getTrafficSpec().MaxMsgSize,
+                                                    (ssize_t)MAXIMUM_MESSAGE_SIZE);
+   while(bytesSent < bytesToSend) {
+      // ====== Send message =============================================
+      const ssize_t chunkSize = std::min(bytesToSend - bytesSent, maxChunkSize);
+      const ssize_t sent =
+         sendMessage(flow, frameID,
+                     (bytesSent == 0),                       // Is frame begin?
+                     (bytesSent + chunkSize >= bytesToSend), // Is frame end?
+                     now, (size_t)chunkSize);
+      // NOTE: Due to minimum size for a NETPERFMETER_DATA chunk (48 B),
+      //       the sent size may be >= chunkSize!
+
+      // ====== Update statistics ========================================
+      if(sent > 0) {
+         bytesSent += sent;
+         packetsSent++;
       }
       else {
-         sid   = ((int64_t)flow->getStreamID() << 2) | QUIC_STREAM_TYPE_UNI_MASK;
-         flags = 0;   // already created by Identify procedure!
+         // Transmission error -> stop sending.
+         checkForAbortedFlow(flow, sent);
+         break;
       }
-      sent = quic_sendmsg(flow->getSocketDescriptor(), (char*)&outputBuffer, bytesToSend, sid, flags);
    }
+}
+
+
+#if defined(HAVE_SENDMMSG)
+#if defined(SO_TXTIME)
+// ###### Convert time stamp to SO_TXTIME transmission time #################
+// Time stamps are CLOCK_REALTIME microseconds, while SO_TXTIME uses
+// CLOCK_MONOTONIC nanoseconds.
+static uint64_t getTxTime(const unsigned long long microTime)
+{
+   timespec realTime;
+   timespec monotonicTime;
+   clock_gettime(CLOCK_REALTIME,  &realTime);
+   clock_gettime(CLOCK_MONOTONIC, &monotonicTime);
+   const long long offset =
+      ((long long)monotonicTime.tv_sec - (long long)realTime.tv_sec) * 1000000000LL +
+      ((long long)monotonicTime.tv_nsec - (long long)realTime.tv_nsec);
+   return (uint64_t)((long long)microTime * 1000LL + offset);
+}
+#endif
+
+
+#if defined(UDP_SEGMENT)
+// ###### Get UDP GSO segment size of flow ##################################
+// The kernel sends each segment as a datagram of its own. Therefore, a
+// segment including the IP and UDP headers has to fit into the path MTU,
+// otherwise the kernel rejects the message. The path MTU is only known
+// for a connected socket. For the passive side's shared UDP socket, the
+// Ethernet MTU is assumed.
+static size_t getGSOSegmentSize(Flow* flow, const size_t maxChunkSize)
+{
+   size_t segmentSize = flow->getGSOSegmentSize();
+   if(segmentSize == 0) {
+      const int      sd                 = flow->getSocketDescriptor();
+      sockaddr_union localAddress;
+      socklen_t      localAddressLength = sizeof(localAddress);
+      size_t         headerSize         = 20 + 8;
+      int            mtu                = 0;
+      socklen_t      mtuLength          = sizeof(mtu);
+      if( (ext_getsockname(sd, &localAddress.sa, &localAddressLength) == 0) &&
+          (localAddress.sa.sa_family == AF_INET6) ) {
+         headerSize = 40 + 8;
+#if defined(IPV6_MTU)
+         if(ext_getsockopt(sd, IPPROTO_IPV6, IPV6_MTU, &mtu, &mtuLength) < 0) {
+            mtu = 0;
+         }
 #endif
-   else if(flow->getTrafficSpec().Protocol == IPPROTO_UDP) {
-      if(flow->isRemoteAddressValid()) {
-         sent = ext_sendto(flow->getSocketDescriptor(),
-                           (char*)&outputBuffer, bytesToSend, 0,
-                           flow->getRemoteAddress(),
-                           getSocklen(flow->getRemoteAddress()));
       }
       else {
-         sent = ext_send(flow->getSocketDescriptor(),
-                         (char*)&outputBuffer, bytesToSend, 0);
+#if defined(IP_MTU)
+         if(ext_getsockopt(sd, IPPROTO_IP, IP_MTU, &mtu, &mtuLength) < 0) {
+            mtu = 0;
+         }
+#endif
+      }
+      if((size_t)mtu < headerSize + sizeof(NetPerfMeterDataMessage)) {
+         mtu = (int)UDP_GSO_DEFAULT_MTU;
       }
+      segmentSize = std::max(std::min(maxChunkSize, (size_t)mtu - headerSize),
+                             sizeof(NetPerfMeterDataMessage));
+      flow->setGSOSegmentSize(segmentSize);
    }
-   else {
-      sent = ext_send(flow->getSocketDescriptor(), (char*)&outputBuffer, bytesToSend, 0);
+   return segmentSize;
+}
+
+
+// ###### Transmit GSO messages segment by segment ##########################
+// Fallback, if the kernel rejects the GSO messages (e.g. after a change of
+// the path MTU). Each segment is sent by a sendmsg() call of its own,
+// without transmission time.
+static bool transmitSegmentsSeparately(Flow*                flow,
+                                       const struct mmsghdr* msgs,
+                                       const unsigned int    messages,
+                                       const unsigned char*  payload,
+                                       ssize_t&              bytesSent,
+                                       size_t&               packetsSent)
+{
+   for(unsigned int i = 0;i < messages;i++) {
+      const struct msghdr& msg = msgs[i].msg_hdr;
+      size_t               j   = 0;
+      while(j < msg.msg_iovlen) {
+         // A segment is its header, followed by a reference to the payload.
+         struct msghdr segment;
+         memset(&segment, 0, sizeof(segment));
+         segment.msg_name    = msg.msg_name;
+         segment.msg_namelen = msg.msg_namelen;
+         segment.msg_iov     = &msg.msg_iov[j];
+         segment.msg_iovlen  = ( (j + 1 < msg.msg_iovlen) &&
+                                 (msg.msg_iov[j + 1].iov_base == (void*)payload) ) ? 2 : 1;
+         j += segment.msg_iovlen;
+
+         const ssize_t sent = sendmsg(flow->getSocketDescriptor(), &segment, 0);
+         if(sent < 0) {
+            checkForAbortedFlow(flow, -1);
+            return false;
+         }
+         bytesSent += sent;
+         packetsSent++;
+      }
    }
+   return true;
+}
+#endif
 
-   // ====== Check, whether flow has been aborted unintentionally ===========
-   if( (sent < 0) &&
-       (errno != EAGAIN) &&
-       (!flow->isAcceptedIncomingFlow()) &&
-       (flow->getTrafficSpec().ErrorOnAbort) &&
-       (flow->getOutputStatus() == Flow::On) ) {
-      LOG_FATAL
-      stdlog << format("Flow #%u on socket %d has been aborted: %s!",
-                       flow->getFlowID(), flow->getSocketDescriptor(),
-                       strerror(errno)) << "\n";
-      LOG_END_FATAL
+
+// ###### Transmit data frame over UDP with batched sendmmsg() calls ########
+// The headers of all fragments of the frame are prepared in one buffer, and
+// each fragment is described by its header and a reference to the payload
+// template. The fragments are handed to the kernel by a single sendmmsg()
+// call per batch, instead of one sendto() system call per fragment. With
+// UDP GSO, consecutive fragments are furthermore coalesced into
+// super-datagrams, which the kernel splits into segments of equal size
+// (only the last segment may be shorter). The segments have to fit into
+// the path MTU, i.e. with GSO, the fragments may be smaller than MaxMsgSize.
+// With kernel pacing by SO_TXTIME, all messages carry the frame's scheduled
+// transmission time.
+static void transmitFrameBatched(Flow*                    flow,
+                                 const uint32_t           frameID,
+                                 const unsigned long long now,
+                                 const ssize_t            bytesToSend,
+                                 ssize_t&                 bytesSent,
+                                 size_t&                  packetsSent)
+{
+   NetPerfMeterDataMessage headers[UDP_BATCH_MAX_SEGMENTS];
+   struct iovec            iov[2 * UDP_BATCH_MAX_SEGMENTS];
+   struct mmsghdr          msgs[UDP_BATCH_MAX_MESSAGES];
+   unsigned int            segments[UDP_BATCH_MAX_MESSAGES];
+   const unsigned char*    payload      = getPayloadTemplate(flow);
+   const ssize_t           maxChunkSize = std::min((ssize_t)flow->getTrafficSpec().MaxMsgSize,
+                                                   (ssize_t)MAXIMUM_MESSAGE_SIZE);
+   ssize_t                 bytesQueued  = 0;
+
+#if defined(UDP_SEGMENT) || defined(SO_TXTIME)
+   alignas(struct cmsghdr) char cmsgBuffer[UDP_BATCH_MAX_MESSAGES][UDP_BATCH_CONTROL_SIZE];
+#endif
+
+   // ====== Get transmission time ==========================================
+#if defined(SO_TXTIME)
+   const uint64_t txTime = (flow->getTxTime() != 0) ? getTxTime(flow->getTxTime()) : 0;
+#endif
+
+   // ====== Get GSO segment size ===========================================
+   unsigned int maxSegments = 1;
+   ssize_t      chunkLimit  = maxChunkSize;
+#if defined(UDP_SEGMENT)
+   size_t segmentSize = 0;
+   if(flow->usesGSO()) {
+      segmentSize = getGSOSegmentSize(flow, (size_t)maxChunkSize);
+      chunkLimit  = (ssize_t)segmentSize;
+      maxSegments = std::min((unsigned int)(UDP_GSO_MAX_SIZE / segmentSize),
+                             (unsigned int)UDP_GSO_MAX_SEGMENTS);
+      if(maxSegments < 1) {
+         maxSegments = 1;
+      }
    }
+#endif
 
-   return sent;
+   while(bytesQueued < bytesToSend) {
+      // ====== Prepare batch of messages ===================================
+      unsigned int messages    = 0;
+      unsigned int headerCount = 0;
+      unsigned int iovCount    = 0;
+      while( (bytesQueued < bytesToSend) && (messages < UDP_BATCH_MAX_MESSAGES) ) {
+         const unsigned int start = iovCount;
+         segments[messages] = 0;
+         while( (bytesQueued < bytesToSend) && (segments[messages] < maxSegments) ) {
+            if(headerCount >= UDP_BATCH_MAX_SEGMENTS) {
+               break;   // Header buffer is full -> send batch first.
+            }
+            const ssize_t chunkSize = std::min(bytesToSend - bytesQueued, chunkLimit);
+            const size_t prepared =
+               prepareNetPerfMeterData(flow, &headers[headerCount], frameID,
+                                       (bytesQueued == 0),                       // Is frame begin?
+                                       (bytesQueued + chunkSize >= bytesToSend), // Is frame end?
+                                       now, (size_t)chunkSize);
+            iov[iovCount].iov_base = (void*)&headers[headerCount];
+            iov[iovCount].iov_len  = sizeof(NetPerfMeterDataMessage);
+            iovCount++;
+            if(prepared > sizeof(NetPerfMeterDataMessage)) {
+               iov[iovCount].iov_base = (void*)payload;
+               iov[iovCount].iov_len  = prepared - sizeof(NetPerfMeterDataMessage);
+               iovCount++;
+            }
+            headerCount++;
+            bytesQueued += (ssize_t)prepared;
+            segments[messages]++;
+         }
+         if(segments[messages] == 0) {
+            break;
+         }
+
+         memset(&msgs[messages], 0, sizeof(msgs[messages]));
+         msgs[messages].msg_hdr.msg_iov    = &iov[start];
+         msgs[messages].msg_hdr.msg_iovlen = iovCount - start;
+         if(flow->isRemoteAddressValid()) {
+            msgs[messages].msg_hdr.msg_name    = (void*)flow->getRemoteAddress();
+            msgs[messages].msg_hdr.msg_namelen = getSocklen(flow->getRemoteAddress());
+         }
+#if defined(UDP_SEGMENT) || defined(SO_TXTIME)
+         size_t controlLength = 0;
+#endif
+#if defined(UDP_SEGMENT)
+         if(segments[messages] > 1) {
+            struct cmsghdr* cmsg = (struct cmsghdr*)&cmsgBuffer[messages][controlLength];
+            cmsg->cmsg_level = SOL_UDP;
+            cmsg->cmsg_type  = UDP_SEGMENT;
+            cmsg->cmsg_len   = CMSG_LEN(sizeof(uint16_t));
+            const uint16_t gsoSize = (uint16_t)segmentSize;
+            memcpy(CMSG_DATA(cmsg), &gsoSize, sizeof(gsoSize));
+            controlLength += CMSG_SPACE(sizeof(uint16_t));
+         }
+#endif
+#if defined(SO_TXTIME)
+         if(txTime != 0) {
+            struct cmsghdr* cmsg = (struct cmsghdr*)&cmsgBuffer[messages][controlLength];
+            cmsg->cmsg_level = SOL_SOCKET;
+            cmsg->cmsg_type  = SCM_TXTIME;
+            cmsg->cmsg_len   = CMSG_LEN(sizeof(uint64_t));
+            memcpy(CMSG_DATA(cmsg), &txTime, sizeof(txTime));
+            controlLength += CMSG_SPACE(sizeof(uint64_t));
+         }
+#endif
+#if defined(UDP_SEGMENT) || defined(SO_TXTIME)
+         if(controlLength > 0) {
+            msgs[messages].msg_hdr.msg_control    = (char*)&cmsgBuffer[messages];
+            msgs[messages].msg_hdr.msg_controllen = controlLength;
+         }
+#endif
+         messages++;
+      }
+
+      // ====== Send batch ==================================================
+      unsigned int done = 0;
+      while(done < messages) {
+         const int result = sendmmsg(flow->getSocketDescriptor(),
+                                     &msgs[done], messages - done, 0);
+#if defined(UDP_SEGMENT)
+         if( (result < 0) && ((errno == EINVAL) || (errno == EMSGSIZE)) &&
+             (maxSegments > 1) ) {
+            // The kernel rejects the GSO segment size -> continue without GSO.
+            LOG_WARNING
+            stdlog << format("GSO with segment size %u failed on UDP socket %d: %s! Sending without GSO instead.",
+                             (unsigned int)segmentSize, flow->getSocketDescriptor(),
+                             strerror(errno)) << "\n";
+            LOG_END
+            flow->disableGSO();
+            if(!transmitSegmentsSeparately(flow, &msgs[done], messages - done, payload,
+                                           bytesSent, packetsSent)) {
+               return;
+            }
+            maxSegments = 1;
+            chunkLimit  = maxChunkSize;
+            break;
+         }
+#endif
+         if(result < 0) {
+            // Transmission error -> stop sending.
+            checkForAbortedFlow(flow, -1);
+            return;
+         }
+         else if(result == 0) {
+            return;   // Nothing sent (errno is not set) -> stop this frame.
+         }
+         for(unsigned int i = done;i < done + (unsigned int)result;i++) {
+            bytesSent   += (ssize_t)msgs[i].msg_len;
+            packetsSent += segments[i];
+         }
+         done += (unsigned int)result;
+      }
+   }
+}
+#endif
+
+
+// ###### Choose protocol-specific transmission functions for flow ##########
+// The functions are chosen once, when the flow's socket is configured.
+// Then, the transmission path of a frame contains only the code needed
+// for the flow's protocol and configuration.
+void configureTransmission(Flow* flow)
+{
+   const int          protocol          = flow->getTrafficSpec().Protocol;
+   FrameTransmitter   frameTransmitter  = transmitFrameByMessages;
+   MessageTransmitter messageTransmitter = sendNetPerfMeterData;
+
+   // ====== Choose function to send a message ==============================
+   if(0) { /* Dummy for following "else if" in #if ... #endif block */ }
+#if defined(HAVE_SCTP)
+   else if(protocol == IPPROTO_SCTP) {
+      messageTransmitter = sendNetPerfMeterDataSCTP;
+   }
+#endif
+#if defined(HAVE_QUIC)
+   else if(protocol == IPPROTO_QUIC) {
+      messageTransmitter = sendNetPerfMeterDataQUIC;
+   }
+#endif
+   else if(protocol == IPPROTO_UDP) {
+      messageTransmitter = sendNetPerfMeterDataUDP;
+   }
+#if defined(MSG_ZEROCOPY)
+   else if(flow->usesZeroCopy()) {
+      messageTransmitter = sendNetPerfMeterDataZeroCopy;
+   }
+#endif
+
+   // ====== Choose function to send a frame ================================
+   if(0) { /* Dummy for following "else if" in #if ... #endif block */ }
+#if defined(HAVE_SENDMMSG)
+   else if(protocol == IPPROTO_UDP) {
+      frameTransmitter = transmitFrameBatched;
+   }
+#endif
+
+   flow->setTransmitters(frameTransmitter, messageTransmitter);
 }
 
 
@@ -203,35 +713,12 @@ bool transmitFrame(Flow*                    flow,
 {
    // ====== Obtain length of data to send ==================================
    ssize_t bytesToSend =
-      (ssize_t)rint(getRandomValue((const double*)&flow->getTrafficSpec().OutboundFrameSize,
-                                   flow->getTrafficSpec().OutboundFrameSizeRng));
+      (ssize_t)rint(flow->nextOutboundFrameSize());
    ssize_t bytesSent   = 0;
    size_t  packetsSent = 0;
    if(bytesToSend > 0) {
       const uint32_t frameID = flow->nextOutboundFrameID();
-      while(bytesSent < (ssize_t)bytesToSend) {
-         // ====== Send message =============================================
-         ssize_t chunkSize = std::min(bytesToSend - bytesSent,
-                                      std::min((ssize_t)flow->getTrafficSpec().MaxMsgSize,
-                                               (ssize_t)MAXIMUM_MESSAGE_SIZE));
-         const ssize_t sent =
-            sendNetPerfMeterData(flow, frameID,
-                                 (bytesSent == 0),                       // Is frame begin?
-                                 (bytesSent + chunkSize >= bytesToSend), // Is frame end?
-                                 now, (size_t)chunkSize);
-         // NOTE: Due to minimum size for a NETPERFMETER_DATA chunk (48 B),
-         //       the sent size may be >= chunkSize!
-
-         // ====== Update statistics ========================================
-         if(sent > 0) {
-            bytesSent += sent;
-            packetsSent++;
-         }
-         else {
-            // Transmission error -> stop sending.
-            break;
-         }
-      }
+      flow->getFrameTransmitter()(flow, frameID, now, bytesToSend, bytesSent, packetsSent);
    }
    else {
       bytesToSend = 0;   // There is nothing to send
@@ -243,42 +730,33 @@ bool transmitFrame(Flow*                    flow,
 }
 
 
-// ###### Handle data message ###############################################
-bool handleNetPerfMeterData(const bool               isActiveMode,
-                            const unsigned long long now,
-                            const int                protocol,
-                            const int                sd)
+// ###### Handle received data message ######################################
+bool handleNetPerfMeterMessage(const bool               isActiveMode,
+                               const unsigned long long now,
+                               const int                protocol,
+                               const int                sd,
+                               const char*              inputBuffer,
+                               const ssize_t            received,
+                               const sockaddr_union*    from,
+                               const int64_t            streamID,
+                               const int                flags)
 {
-   char            inputBuffer[65536];
-   sockaddr_union  from;
-   socklen_t       fromlen  = sizeof(from);
-   int             flags    = 0;
-   int64_t         streamID = 0;
-
-   // ====== Read message (or fragment) =====================================
-   const ssize_t received =
-      FlowManager::getFlowManager()->getMessageReader()->receiveMessage(
-         sd, &inputBuffer, sizeof(inputBuffer), &from.sa, &fromlen, &streamID, &flags);
-   if(received == MRRM_PARTIAL_READ) {
-      return true;   // Partial read -> wait for next fragment.
-   }
-
    // ====== Handle data ====================================================
    if(received > 0) {
 #if defined(HAVE_SCTP)
       if(!(flags & MSG_NOTIFICATION)) {
 #endif
          const NetPerfMeterDataMessage*     dataMsg     =
-            (const NetPerfMeterDataMessage*)&inputBuffer;
+            (const NetPerfMeterDataMessage*)inputBuffer;
          const NetPerfMeterIdentifyMessage* identifyMsg =
-            (const NetPerfMeterIdentifyMessage*)&inputBuffer;
+            (const NetPerfMeterIdentifyMessage*)inputBuffer;
 
          // ====== Handle NETPERFMETER_IDENTIFY_FLOW message ================
          if( (received >= (ssize_t)sizeof(NetPerfMeterIdentifyMessage)) &&
             (identifyMsg->Header.Type == NETPERFMETER_IDENTIFY_FLOW) &&
             (be64toh(identifyMsg->MagicNumber) == NETPERFMETER_IDENTIFY_FLOW_MAGIC_NUMBER) ) {
             const bool identifyOkay =
-               handleNetPerfMeterIdentify(identifyMsg, sd, &from);
+               handleNetPerfMeterIdentify(identifyMsg, sd, from);
             if(!identifyOkay) {
                LOG_WARNING
                stdlog << format("Failed handling NETPERFMETER_IDENTIFY on socket %d!", sd) << "\n";
@@ -296,7 +774,7 @@ bool handleNetPerfMeterData(const bool               isActiveMode,
             // ====== Identify flow =========================================
             Flow* flow;
             if( (protocol == IPPROTO_UDP) && (!isActiveMode) ) {
-               flow = FlowManager::getFlowManager()->findFlow(&from.sa);
+               flow = FlowManager::getFlowManager()->findFlow(&from->sa);
             }
             else if(protocol == IPPROTO_SCTP) {
                // Flow ID = SCTP stream ID:
@@ -315,7 +793,11 @@ bool handleNetPerfMeterData(const bool               isActiveMode,
             }
             if(flow) {
                // Update flow statistics by received NETPERFMETER_DATA message.
-               updateStatistics(flow, now, dataMsg, (size_t)received);
+               // The FlowManager is locked here, i.e. the flow's socket
+               // cannot change.
+               updateStatistics(
+                  FlowManager::getFlowManager()->getReceiverThread(flow->getSocketDescriptor()),
+                  flow, now, dataMsg, (size_t)received);
             }
             else {
                LOG_WARNING
@@ -380,12 +862,177 @@ bool handleNetPerfMeterData(const bool               isActiveMode,
 }
 
 
+// ###### Handle received data message by the socket's ReceiverThread #######
+// The flow is found in the ReceiverThread's own flow map. Neither the
+// FlowManager nor the flow get locked: the caller holds the lock of the
+// ReceiverThread, which serialises the reception state of its flows.
+// Returns false, if the message has to be handled by
+// handleNetPerfMeterMessage() instead.
+bool handleNetPerfMeterDataByReceiver(ReceiverThread*          receiverThread,
+                                      const unsigned long long now,
+                                      const int                protocol,
+                                      const int                sd,
+                                      const char*              inputBuffer,
+                                      const ssize_t            received,
+                                      const sockaddr_union*    from,
+                                      const int64_t            streamID,
+                                      const int                flags)
+{
+   const NetPerfMeterDataMessage* dataMsg =
+      (const NetPerfMeterDataMessage*)inputBuffer;
+   if( (received < (ssize_t)sizeof(NetPerfMeterDataMessage)) ||
+#if defined(HAVE_SCTP)
+       (flags & MSG_NOTIFICATION) ||
+#endif
+       (dataMsg->Header.Type != NETPERFMETER_DATA) ) {
+      return false;
+   }
+
+   // ====== Identify flow ==================================================
+   uint16_t flowStreamID = 0;
+   if(protocol == IPPROTO_SCTP) {
+      flowStreamID = (uint16_t)streamID;
+   }
+#if defined(HAVE_QUIC)
+   else if(protocol == IPPROTO_QUIC) {
+      flowStreamID = (uint16_t)(streamID >> 2);
+   }
+#endif
+   Flow* flow = receiverThread->findFlow(sd, flowStreamID);
+   if( (flow == nullptr) || (flow->getInputStatus() == Flow::Off) ) {
+      return false;
+   }
+   if( (protocol == IPPROTO_UDP) && (flow->isAcceptedIncomingFlow()) &&
+       ( (!flow->isRemoteAddressValid()) ||
+         (addresscmp(&from->sa, flow->getRemoteAddress(), true) != 0) ) ) {
+      // Incoming UDP flows are identified by their source address.
+      return false;
+   }
+
+   // ====== Update flow statistics =========================================
+   updateStatistics(receiverThread, flow, now, dataMsg, (size_t)received);
+   return true;
+}
+
+
+// ###### Handle data message ###############################################
+bool handleNetPerfMeterData(const bool               isActiveMode,
+                            const unsigned long long now,
+                            const int                protocol,
+                            const int                sd)
+{
+   MessageReader*  messageReader = FlowManager::getFlowManager()->getMessageReader(sd);
+   char            inputBuffer[65536];
+   sockaddr_union  from;
+   socklen_t       fromlen;
+   int             flags;
+   int64_t         streamID;
+   bool            success;
+
+   do {
+      // ====== Read message (or fragment) ==================================
+      fromlen  = sizeof(from);
+      flags    = 0;
+      streamID = 0;
+      const ssize_t received =
+         messageReader->receiveMessage(sd, &inputBuffer, sizeof(inputBuffer),
+                                       &from.sa, &fromlen, &streamID, &flags);
+      if(received == MRRM_PARTIAL_READ) {
+         return true;   // Partial read -> wait for next fragment.
+      }
+
+      success = handleNetPerfMeterMessage(isActiveMode, now, protocol, sd,
+                                   (const char*)&inputBuffer, received,
+                                   &from, streamID, flags);
+      // In buffered mode, the MessageReader may already hold further
+      // messages. They have to be handled now, since poll() will not
+      // report them!
+   } while( (success) && (messageReader->hasBufferedMessage(sd)) );
+
+   return success;
+}
+
+
+#if defined(HAVE_RECVMMSG)
+// ###### Handle batch of data messages from UDP socket #####################
+// Up to UDP_RECEIVE_BATCH_SIZE datagrams are read by a single recvmmsg()
+// call, and all of them are processed with the same time stamp. The caller
+// has to hold the FlowManager lock; the static buffers are only used by the
+// main loop thread.
+// With UDP GRO, a datagram may be a coalesced super-datagram. It is then
+// split into its segments of the size given by the UDP_GRO control message,
+// i.e. each segment is handled as a separate NETPERFMETER_DATA message.
+unsigned int handleNetPerfMeterDataBatch(const bool               isActiveMode,
+                                         const unsigned long long now,
+                                         const int                sd)
+{
+   static char           inputBuffer[UDP_RECEIVE_BATCH_SIZE][MAXIMUM_MESSAGE_SIZE];
+   static sockaddr_union from[UDP_RECEIVE_BATCH_SIZE];
+   struct mmsghdr        msgs[UDP_RECEIVE_BATCH_SIZE];
+   struct iovec          iov[UDP_RECEIVE_BATCH_SIZE];
+#if defined(UDP_GRO)
+   alignas(struct cmsghdr) char cmsgBuffer[UDP_RECEIVE_BATCH_SIZE][CMSG_SPACE(sizeof(int))];
+#endif
+
+   // ====== Read messages ==================================================
+   for(unsigned int i = 0;i < UDP_RECEIVE_BATCH_SIZE;i++) {
+      iov[i].iov_base = (char*)&inputBuffer[i];
+      iov[i].iov_len  = sizeof(inputBuffer[i]);
+      memset(&msgs[i], 0, sizeof(msgs[i]));
+      msgs[i].msg_hdr.msg_name       = &from[i];
+      msgs[i].msg_hdr.msg_namelen    = sizeof(from[i]);
+      msgs[i].msg_hdr.msg_iov        = &iov[i];
+      msgs[i].msg_hdr.msg_iovlen     = 1;
+#if defined(UDP_GRO)
+      msgs[i].msg_hdr.msg_control    = (char*)&cmsgBuffer[i];
+      msgs[i].msg_hdr.msg_controllen = sizeof(cmsgBuffer[i]);
+#endif
+   }
+   const int messages = recvmmsg(sd, (struct mmsghdr*)&msgs, UDP_RECEIVE_BATCH_SIZE,
+                                 MSG_DONTWAIT, nullptr);
+   if(messages <= 0) {
+      return 0;
+   }
+
+   // ====== Handle messages ================================================
+   for(unsigned int i = 0;i < (unsigned int)messages;i++) {
+      const size_t received    = msgs[i].msg_len;
+      size_t       segmentSize = received;
+#if defined(UDP_GRO)
+      for(struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msgs[i].msg_hdr);
+          cmsg != nullptr; cmsg = CMSG_NXTHDR(&msgs[i].msg_hdr, cmsg)) {
+         if( (cmsg->cmsg_level == SOL_UDP) && (cmsg->cmsg_type == UDP_GRO) ) {
+            int gsoSize;
+            memcpy(&gsoSize, CMSG_DATA(cmsg), sizeof(gsoSize));
+            if(gsoSize > 0) {
+               segmentSize = (size_t)gsoSize;
+            }
+         }
+      }
+#endif
+      for(size_t offset = 0;offset < received;offset += segmentSize) {
+         handleNetPerfMeterMessage(isActiveMode, now, IPPROTO_UDP, sd,
+                            (const char*)&inputBuffer[i][offset],
+                            (ssize_t)std::min(segmentSize, received - offset),
+                            &from[i], 0, 0);
+      }
+   }
+   return (unsigned int)messages;
+}
+#endif
+
+
 // ###### Update flow statistics with incoming NETPERFMETER_DATA message ####
-static void updateStatistics(Flow*                          flow,
+// The reception state of a flow is serialised by the ReceiverThread of its
+// socket. Its lock is recursive, i.e. the caller may already hold it.
+static void updateStatistics(ReceiverThread*                receiverThread,
+                             Flow*                          flow,
                              const unsigned long long       now,
                              const NetPerfMeterDataMessage* dataMsg,
                              const size_t                   receivedBytes)
 {
+   receiverThread->lock();
+
    // ====== Update QoS statistics ==========================================
    const uint64_t seqNumber   = be64toh(dataMsg->SeqNumber);
    const uint64_t timeStamp   = be64toh(dataMsg->TimeStamp);
@@ -415,4 +1062,6 @@ static void updateStatistics(Flow*                          flow,
       now, receivedFrames, receivedBytes,
       lostFrames, lostPackets, lostBytes,
       (unsigned long long)seqNumber, transitTime, diff, jitter);
+
+   receiverThread->unlock();
 }
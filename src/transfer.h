@@ -35,12 +35,38 @@
 #include <sys/types.h>
 
 
+class ReceiverThread;
+
+void configureTransmission(Flow* flow);
 bool transmitFrame(Flow*                    flow,
                    const unsigned long long now);
 
+bool handleNetPerfMeterMessage(const bool               isActiveMode,
+                               const unsigned long long now,
+                               const int                protocol,
+                               const int                sd,
+                               const char*              inputBuffer,
+                               const ssize_t            received,
+                               const sockaddr_union*    from,
+                               const int64_t            streamID,
+                               const int                flags);
+bool handleNetPerfMeterDataByReceiver(ReceiverThread*          receiverThread,
+                                      const unsigned long long now,
+                                      const int                protocol,
+                                      const int                sd,
+                                      const char*              inputBuffer,
+                                      const ssize_t            received,
+                                      const sockaddr_union*    from,
+                                      const int64_t            streamID,
+                                      const int                flags);
 bool handleNetPerfMeterData(const bool               isActiveMode,
                             const unsigned long long now,
                             const int                protocol,
                             const int                sd);
+#if defined(HAVE_RECVMMSG)
+unsigned int handleNetPerfMeterDataBatch(const bool               isActiveMode,
+                                         const unsigned long long now,
+                                         const int                sd);
+#endif
 
 #endif